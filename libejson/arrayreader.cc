@@ -0,0 +1,173 @@
+#include "arrayreader.hh"
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+using namespace eee;
+
+ArrayReader::Iterator::Iterator() : _reader(nullptr), _value() {
+}
+
+ArrayReader::Iterator::Iterator(ArrayReader *reader)
+    : _reader(reader), _value() {
+    ++*this;
+}
+
+const Json &ArrayReader::Iterator::operator*() const {
+    return _value;
+}
+
+const Json *ArrayReader::Iterator::operator->() const {
+    return &_value;
+}
+
+ArrayReader::Iterator &ArrayReader::Iterator::operator++() {
+    if (!_reader->next(_value)) { _reader = nullptr; }
+    return *this;
+}
+
+bool ArrayReader::Iterator::operator==(const Iterator &other) const {
+    return _reader == other._reader;
+}
+
+bool ArrayReader::Iterator::operator!=(const Iterator &other) const {
+    return _reader != other._reader;
+}
+
+ArrayReader::ArrayReader(std::istream &in, std::size_t chunkSize)
+    : _in(&in), _buffer(), _pos(0), _start(0), _offset(0)
+    , _chunkSize(chunkSize == 0 ? 1 : chunkSize), _state(State::OPEN)
+    , _checkpoint(0), _parser() {
+    _parser.setKeepValue(false);
+    // Resuming needs offsets relative to the start of the input.
+    std::istream::pos_type start = in.tellg();
+    if (start != std::istream::pos_type(-1)) {
+        _offset = static_cast<std::uint64_t>(start);
+    }
+    _checkpoint = _offset;
+}
+
+ArrayReader ArrayReader::resume(
+    std::istream &in, std::uint64_t checkpoint, std::size_t chunkSize) {
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(checkpoint));
+    if (!in) { throw std::runtime_error("seek failed !"); }
+    ArrayReader reader(in, chunkSize);
+    reader._state = State::NEXT;
+    return reader;
+}
+
+void ArrayReader::fail(const char *what) const {
+    throw std::logic_error(
+        std::string(what) + " (offset " + std::to_string(_offset + _pos)
+        + ")");
+}
+
+bool ArrayReader::fill() {
+    // Drop the input before _start here rather than after every element, so
+    // the buffer is compacted once per chunk.
+    if (_start > 0) {
+        _buffer.erase(0, _start);
+        _offset += _start;
+        _pos -= _start;
+        _start = 0;
+    }
+    const std::size_t size = _buffer.size();
+    _buffer.resize(size + _chunkSize);
+    _in->read(&_buffer[size], static_cast<std::streamsize>(_chunkSize));
+    _buffer.resize(size + static_cast<std::size_t>(_in->gcount()));
+    return _buffer.size() > size;
+}
+
+char ArrayReader::peek() {
+    for (;;) {
+        if (_pos == _buffer.size()) {
+            _start = _pos;
+            if (!fill()) { return '\0'; }
+        }
+        const char c = _buffer[_pos];
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') { return c; }
+        _pos++;
+    }
+}
+
+void ArrayReader::close() {
+    _pos++;
+    _state = State::DONE;
+    if (peek() != '\0') { fail("array trailing data !"); }
+}
+
+bool ArrayReader::next(Json &element) {
+    switch (_state) {
+        case State::DONE:
+            return false;
+        case State::OPEN:
+            if (peek() != '[') { fail("array failed !"); }
+            _pos++;
+            _state = State::FIRST;
+            [[fallthrough]];
+        case State::FIRST:
+            if (peek() == ']') {
+                close();
+                return false;
+            }
+            break;
+        case State::NEXT: {
+            const char c = peek();
+            if (c == ']') {
+                close();
+                return false;
+            }
+            if (c != ',') { fail("array failed !"); }
+            _pos++;
+            break;
+        }
+    }
+
+    // Find where the element ends: the ',' or ']' at depth 0.
+    if (peek() == '\0') { fail("array end failed !"); }
+    _start = _pos;
+    std::size_t depth = 0;
+    bool inString = false, escape = false;
+    for (;; _pos++) {
+        if (_pos == _buffer.size() && !fill()) { fail("array end failed !"); }
+        const char c = _buffer[_pos];
+        if (inString) {
+            if (escape) {
+                escape = false;
+            } else if (c == '\\') {
+                escape = true;
+            } else if (c == '"') {
+                inString = false;
+            }
+        } else if (c == '"') {
+            inString = true;
+        } else if (c == '[' || c == '{') {
+            depth++;
+        } else if (c == ']' || c == '}') {
+            if (depth == 0) { break; }
+            depth--;
+        } else if (c == ',' && depth == 0) {
+            break;
+        }
+    }
+    if (_pos == _start) { fail("array failed !"); }
+    // Parsed where it lies in the buffer, the element is not copied.
+    element = _parser.parseView(
+        std::string_view(_buffer).substr(_start, _pos - _start));
+    _checkpoint = _offset + _pos;
+    _state = State::NEXT;
+    return true;
+}
+
+std::uint64_t ArrayReader::checkpoint() const {
+    return _checkpoint;
+}
+
+ArrayReader::Iterator ArrayReader::begin() {
+    return Iterator(this);
+}
+
+ArrayReader::Iterator ArrayReader::end() {
+    return Iterator();
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "json.hh"
+#include "parser.hh"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <string>
+
+namespace eee {
+
+//! \brief Reads the elements of a top-level JSON array from a stream one at
+//! a time.
+//!
+//! The stream is read sequentially in chunks. Only the element being parsed
+//! and the rest of the current chunk are held, so memory is bounded by the
+//! largest element rather than by the input. After each element,
+//! checkpoint() is the input offset to resume() from, for example after a
+//! crash, without reading the elements before it again.
+//!
+//! \code
+//! std::ifstream file("records.json");
+//! eee::ArrayReader reader(file);
+//! for (const eee::Json &record : reader) { ... }
+//! \endcode
+class ArrayReader {
+  public:
+    //! \brief Input iterator over the remaining elements
+    class Iterator {
+      private:
+        ArrayReader *_reader;
+        Json _value;
+
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Json;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Json *;
+        using reference = const Json &;
+
+        //! \brief The end iterator
+        Iterator();
+        //! \brief Read the first element of reader
+        explicit Iterator(ArrayReader *reader);
+
+        const Json &operator*() const;
+        const Json *operator->() const;
+        Iterator &operator++();
+        bool operator==(const Iterator &other) const;
+        bool operator!=(const Iterator &other) const;
+    };
+
+  private:
+    //! \brief What is expected next in the input
+    enum class State { OPEN, FIRST, NEXT, DONE };
+
+    std::istream *_in;
+    //! \brief Input read ahead, starting at input offset _offset
+    std::string _buffer;
+    //! \brief Read position in _buffer
+    std::size_t _pos;
+    //! \brief Start in _buffer of the input still needed, the element being
+    //! read; fill() drops what comes before it
+    std::size_t _start;
+    //! \brief Input offset of _buffer[0]
+    std::uint64_t _offset;
+    //! \brief Bytes read from the stream at a time
+    std::size_t _chunkSize;
+    State _state;
+    //! \brief Input offset just past the last element returned
+    std::uint64_t _checkpoint;
+    //! \brief Parses each element, keeping its scratch between elements
+    Parser _parser;
+
+    //! \brief Drop the input before _start and append the next chunk of
+    //! the stream to _buffer
+    //! \return 'false' at the end of the stream
+    bool fill();
+    //! \brief Skip white space, reading more input as needed
+    //! \return The next character, '\0' at the end of input
+    char peek();
+    //! \brief Consume the closing ']', which only white space may follow
+    void close();
+    //! \brief Throw a std::logic_error mentioning the input offset
+    [[noreturn]] void fail(const char *what) const;
+
+  public:
+    //! \param in Stream positioned at the array, which must outlive the
+    //! reader
+    //! \param chunkSize Bytes read from in at a time
+    explicit ArrayReader(std::istream &in, std::size_t chunkSize = 64 * 1024);
+
+    //! \brief Continue reading the array of in after the element that ended
+    //! at checkpoint, an earlier checkpoint() over the same input. in is
+    //! seeked to it, so it must be seekable.
+    static ArrayReader resume(
+        std::istream &in,
+        std::uint64_t checkpoint,
+        std::size_t chunkSize = 64 * 1024);
+
+    //! \brief Read the next element.
+    //! \return 'false' after the last element
+    bool next(Json &element);
+    //! \brief Input offset just past the last element returned by next()
+    std::uint64_t checkpoint() const;
+
+    Iterator begin();
+    Iterator end();
+};
+
+} // namespace eee
@@ -0,0 +1,75 @@
+#include "async.hh"
+
+using namespace eee;
+
+void Executor::schedule(std::coroutine_handle<> h) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _ready.push_back(h);
+}
+
+std::size_t Executor::run() {
+    std::size_t count = 0;
+    for (;;) {
+        std::coroutine_handle<> h;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_ready.empty()) { return count; }
+            h = _ready.front();
+            _ready.pop_front();
+        }
+        h.resume();
+        count++;
+    }
+}
+
+PipeSource::PipeSource(Executor &executor)
+    : _executor(executor), _chunks(), _current(), _closed(false), _waiting()
+    , _mutex() {
+}
+
+void PipeSource::write(std::string chunk) {
+    // An empty chunk would read as the end of input.
+    if (chunk.empty()) { return; }
+    std::coroutine_handle<> waiting;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _chunks.push_back(std::move(chunk));
+        waiting = std::exchange(_waiting, {});
+    }
+    if (waiting) { _executor.schedule(waiting); }
+}
+
+void PipeSource::close() {
+    std::coroutine_handle<> waiting;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        waiting = std::exchange(_waiting, {});
+    }
+    if (waiting) { _executor.schedule(waiting); }
+}
+
+PipeSource::ReadAwaiter PipeSource::read() {
+    return ReadAwaiter(this);
+}
+
+bool PipeSource::ReadAwaiter::await_ready() {
+    std::lock_guard<std::mutex> lock(_pipe->_mutex);
+    return !_pipe->_chunks.empty() || _pipe->_closed;
+}
+
+bool PipeSource::ReadAwaiter::await_suspend(std::coroutine_handle<> h) {
+    std::lock_guard<std::mutex> lock(_pipe->_mutex);
+    // A chunk may have arrived since await_ready().
+    if (!_pipe->_chunks.empty() || _pipe->_closed) { return false; }
+    _pipe->_waiting = h;
+    return true;
+}
+
+std::string_view PipeSource::ReadAwaiter::await_resume() {
+    std::lock_guard<std::mutex> lock(_pipe->_mutex);
+    if (_pipe->_chunks.empty()) { return {}; }
+    _pipe->_current = std::move(_pipe->_chunks.front());
+    _pipe->_chunks.pop_front();
+    return _pipe->_current;
+}
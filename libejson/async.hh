@@ -0,0 +1,183 @@
+#pragma once
+
+#if __cplusplus < 202002L
+#error "async.hh needs C++20, build with -DEJSON_COROUTINES=ON"
+#endif
+
+#include "json.hh"
+#include "pushparser.hh"
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace eee {
+
+//! \brief A lazily started coroutine producing a T.
+//!
+//! co_await on a Task starts it and resumes the awaiting coroutine when it
+//! finishes. Outside a coroutine, start() runs it up to its first suspension
+//! and result() collects the value once done(). Exceptions thrown by the
+//! coroutine are rethrown from co_await or result().
+template <typename T>
+class Task {
+  public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        //! \brief Coroutine awaiting this one, resumed at the end
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+        struct FinalAwaiter {
+            bool await_ready() noexcept {
+                return false;
+            }
+            std::coroutine_handle<>
+            await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                auto next = h.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {
+            }
+        };
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+        template <typename U>
+        void return_value(U &&value) {
+            this->value.emplace(std::forward<U>(value));
+        }
+        void unhandled_exception() {
+            error = std::current_exception();
+        }
+    };
+
+  private:
+    std::coroutine_handle<promise_type> _handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : _handle(handle) {
+    }
+
+  public:
+    Task(Task &&other) noexcept : _handle(std::exchange(other._handle, {})) {
+    }
+    Task(const Task &other) = delete;
+    Task &operator=(const Task &other) = delete;
+    Task &operator=(Task &&other) = delete;
+    ~Task() {
+        if (_handle) { _handle.destroy(); }
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        _handle.promise().continuation = awaiting;
+        return _handle;
+    }
+    T await_resume() {
+        return result();
+    }
+
+    //! \brief Run the coroutine until it first suspends or finishes
+    void start() {
+        _handle.resume();
+    }
+    //! \return 'true' once the coroutine has finished
+    bool done() const {
+        return _handle.done();
+    }
+    //! \brief The produced value, only valid once done()
+    T result() {
+        auto &promise = _handle.promise();
+        if (promise.error) { std::rethrow_exception(promise.error); }
+        return std::move(*promise.value);
+    }
+};
+
+//! \brief A run queue of suspended coroutines, drained by any number of
+//! threads calling run().
+class Executor {
+  private:
+    std::deque<std::coroutine_handle<>> _ready;
+    std::mutex _mutex;
+
+  public:
+    //! \brief Queue h to be resumed by run()
+    void schedule(std::coroutine_handle<> h);
+    //! \brief Resume queued coroutines until the queue is empty
+    //! \return Number of coroutines resumed
+    std::size_t run();
+};
+
+//! \brief An in-process byte source: a producer write()s chunks, a
+//! coroutine co_awaits read() and is suspended while no chunk is available,
+//! to be resumed on the Executor when one arrives. Useful to test code that
+//! reads from sockets or other asynchronous streams.
+class PipeSource {
+  private:
+    Executor &_executor;
+    std::deque<std::string> _chunks;
+    //! \brief The chunk returned by the last read()
+    std::string _current;
+    bool _closed;
+    //! \brief Reader suspended in read(), if any
+    std::coroutine_handle<> _waiting;
+    std::mutex _mutex;
+
+  public:
+    class ReadAwaiter {
+      private:
+        PipeSource *_pipe;
+
+      public:
+        explicit ReadAwaiter(PipeSource *pipe) : _pipe(pipe) {
+        }
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> h);
+        std::string_view await_resume();
+    };
+
+    explicit PipeSource(Executor &executor);
+
+    //! \brief Append a chunk, waking a suspended reader
+    void write(std::string chunk);
+    //! \brief End of input, waking a suspended reader
+    void close();
+    //! \brief Awaitable giving the next chunk, valid until the next read(),
+    //! or an empty view at the end of input
+    ReadAwaiter read();
+};
+
+//! \brief Parse JSON pulled from source as it arrives.
+//!
+//! source is any object whose read() is awaitable and yields a
+//! std::string_view chunk, empty at the end of input; it must outlive the
+//! task. The coroutine suspends whenever the source has no data instead of
+//! blocking its thread, and each chunk is parsed by a PushParser as soon as it
+//! arrives.
+template <typename Source>
+Task<Json> parseAsync(Source &source, bool strictUtf8 = false) {
+    PushParser parser(strictUtf8);
+    for (;;) {
+        std::string_view chunk = co_await source.read();
+        if (chunk.empty()) { break; }
+        parser.feed(chunk);
+    }
+    co_return parser.finish();
+}
+
+} // namespace eee
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "json.hh"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+namespace eee {
+
+//! \brief One decoded header of a binary encoding (MessagePack or CBOR).
+//! Strings are views into the input buffer; containers only carry their
+//! element count, the elements follow as separate items.
+struct BinaryItem {
+    //! Marks a container whose length is not known up front (CBOR only).
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    Type type = Type::JSON_NULL;
+    bool boolean = false;
+    std::int64_t integer = 0;
+    double number = 0.0;
+    std::string_view string;
+    //! Number of elements (array) or key/value pairs (object), or npos.
+    std::size_t size = 0;
+};
+
+//! \brief Containers nested deeper than this are rejected by
+//! readBinaryJson(), which decodes them recursively.
+constexpr std::size_t kMaxBinaryDepth = 1024;
+
+//! \brief Decode one complete value from a binary reader into a Json.
+//! Integers that do not fit into an int become doubles.
+//! \param reader MsgpackReader or CborReader
+//! \param depth Number of containers enclosing the value
+//! \throw std::logic_error if containers nest deeper than kMaxBinaryDepth
+template <typename Reader>
+Json readBinaryJson(Reader &reader, std::size_t depth = 0) {
+    BinaryItem item = reader.next();
+    if ((item.type == Type::JSON_ARRAY || item.type == Type::JSON_OBJECT)
+        && depth >= kMaxBinaryDepth) {
+        throw std::logic_error("binary nesting is too deep !");
+    }
+    switch (item.type) {
+        case Type::JSON_NULL:
+            return Json();
+        case Type::JSON_BOOL:
+            return Json(item.boolean);
+        case Type::JSON_INT:
+            if (item.integer < std::numeric_limits<int>::min()
+                || item.integer > std::numeric_limits<int>::max()) {
+                return Json(static_cast<double>(item.integer));
+            }
+            return Json(static_cast<int>(item.integer));
+        case Type::JSON_DOUBLE:
+            return Json(item.number);
+        case Type::JSON_STRING:
+            return Json(std::string(item.string));
+        case Type::JSON_ARRAY: {
+            std::vector<Json> data;
+            if (item.size == BinaryItem::npos) {
+                while (!reader.nextIsBreak()) {
+                    data.emplace_back(readBinaryJson(reader, depth + 1));
+                }
+            } else {
+                data.reserve(item.size);
+                for (std::size_t i = 0; i < item.size; i++) {
+                    data.emplace_back(readBinaryJson(reader, depth + 1));
+                }
+            }
+            return Json(std::move(data));
+        }
+        case Type::JSON_OBJECT: {
+            std::map<std::string, Json> data;
+            for (std::size_t i = 0; item.size == BinaryItem::npos
+                                        ? !reader.nextIsBreak()
+                                        : i < item.size;
+                 i++) {
+                BinaryItem key = reader.next();
+                if (key.type != Type::JSON_STRING) {
+                    throw std::logic_error("binary map key is not string !");
+                }
+                data[std::string(key.string)] =
+                    readBinaryJson(reader, depth + 1);
+            }
+            return Json(std::move(data));
+        }
+    }
+    return Json();
+}
+
+} // namespace eee
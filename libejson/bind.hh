@@ -0,0 +1,379 @@
+#pragma once
+
+#include "escape.hh"
+#include "json.hh"
+#include "tokenizer.hh"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! \file
+//! \brief Declarative binding between JSON text and C++ types.
+//!
+//! A struct is bound by listing its members next to it:
+//! \code
+//! struct Point { int x; int y; std::optional<std::string> label; };
+//! EJSON_BIND(Point, x, y, label)
+//! \endcode
+//! eee::parseAs<Point>(text) then reads JSON straight into the struct through
+//! the Tokenizer, without building a Json, and eee::stringify(point) writes
+//! it back. Bound structs nest, and std::vector, std::optional,
+//! std::map<std::string, T>, arithmetic types, std::string and Json are
+//! supported as members. Keys are dispatched through a perfect hash table
+//! computed at compile time; unknown keys are skipped and missing keys keep
+//! the member's value. EJSON_BIND must be used in the namespace of the type.
+//! To use JSON names that differ from member names, write the descriptor
+//! function by hand:
+//! \code
+//! constexpr auto ejsonFields(Point *) {
+//!     return std::make_tuple(eee::field("X", &Point::x), ...);
+//! }
+//! \endcode
+
+namespace eee {
+
+//! \brief Descriptor of one bound member.
+template <typename T, typename M>
+struct Field {
+    std::string_view name;
+    M T::*member;
+};
+
+//! \brief Describe the member of T that is called name in JSON.
+template <typename T, typename M>
+constexpr Field<T, M> field(std::string_view name, M T::*member) {
+    return {name, member};
+}
+
+namespace bind_detail {
+
+constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+//! \brief Seeded FNV-1a
+constexpr std::uint32_t hash(std::string_view key, std::uint32_t seed) {
+    std::uint32_t h = 2166136261u ^ seed;
+    for (char c : key) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+constexpr std::size_t table_size(std::size_t n) {
+    std::size_t size = 1;
+    while (size < 2 * n) { size <<= 1; }
+    return size;
+}
+
+//! \brief Perfect hash table from key to field index.
+template <std::size_t N>
+struct KeyTable {
+    static constexpr std::size_t kSize = table_size(N);
+    static_assert(N < 255, "too many bound fields");
+
+    std::uint32_t seed = 0;
+    //! field index + 1, 0 for an empty slot
+    std::array<std::uint8_t, kSize> slots{};
+    std::array<std::string_view, N> names{};
+
+    //! \return The field index, or npos for unknown keys
+    constexpr std::size_t find(std::string_view key) const {
+        std::uint8_t slot = slots[hash(key, seed) & (kSize - 1)];
+        if (slot == 0 || names[slot - 1] != key) { return npos; }
+        return slot - 1;
+    }
+};
+
+//! \brief Search a seed that maps every name to its own slot. Fails the
+//! constant evaluation (and so the build) for duplicate names.
+template <std::size_t N>
+constexpr KeyTable<N> make_key_table(
+    const std::array<std::string_view, N> &names) {
+    KeyTable<N> table;
+    table.names = names;
+    for (std::uint32_t seed = 0; seed < (1u << 16); seed++) {
+        std::array<std::uint8_t, KeyTable<N>::kSize> slots{};
+        bool ok = true;
+        for (std::size_t i = 0; i < N && ok; i++) {
+            std::size_t h = hash(names[i], seed) & (KeyTable<N>::kSize - 1);
+            if (slots[h] != 0) { ok = false; }
+            slots[h] = static_cast<std::uint8_t>(i + 1);
+        }
+        if (ok) {
+            table.seed = seed;
+            table.slots = slots;
+            return table;
+        }
+    }
+    throw std::logic_error("bound field names are not unique !");
+}
+
+template <typename T, typename = void>
+struct is_bound : std::false_type {};
+template <typename T>
+struct is_bound<
+    T,
+    std::void_t<decltype(ejsonFields(static_cast<T *>(nullptr)))>>
+    : std::true_type {};
+
+template <typename T>
+struct is_vector : std::false_type {};
+template <typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <typename T>
+struct is_optional : std::false_type {};
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct is_map : std::false_type {};
+template <typename T, typename C, typename A>
+struct is_map<std::map<std::string, T, C, A>> : std::true_type {};
+
+template <typename T>
+struct always_false : std::false_type {};
+
+template <typename T>
+void read(Tokenizer &tk, T &out);
+template <typename T>
+void write(std::string &out, const T &value);
+
+//! \brief Compile-time tables of a bound struct.
+template <typename T>
+struct Binder {
+    static constexpr auto fields = ejsonFields(static_cast<T *>(nullptr));
+    static constexpr std::size_t size =
+        std::tuple_size_v<std::remove_const_t<decltype(fields)>>;
+    using Reader = void (*)(Tokenizer &, T &);
+
+    template <std::size_t I>
+    static void read_field(Tokenizer &tk, T &out) {
+        read(tk, out.*(std::get<I>(fields).member));
+    }
+
+    template <std::size_t... I>
+    static constexpr std::array<std::string_view, size> names(
+        std::index_sequence<I...>) {
+        return {std::get<I>(fields).name...};
+    }
+
+    template <std::size_t... I>
+    static constexpr std::array<Reader, size> readers(
+        std::index_sequence<I...>) {
+        return {&read_field<I>...};
+    }
+
+    static constexpr auto table =
+        make_key_table(names(std::make_index_sequence<size>{}));
+    static constexpr auto dispatch =
+        readers(std::make_index_sequence<size>{});
+};
+
+template <typename T>
+void read_struct(Tokenizer &tk, T &out) {
+    tk.expect('{');
+    if (tk.consume('}')) { return; }
+    do {
+        std::size_t i = Binder<T>::table.find(tk.readString());
+        tk.expect(':');
+        if (i == npos) {
+            tk.skipValue();
+        } else {
+            Binder<T>::dispatch[i](tk, out);
+        }
+    } while (tk.consume(','));
+    tk.expect('}');
+}
+
+template <typename T>
+void read(Tokenizer &tk, T &out) {
+    if constexpr (std::is_same_v<T, bool>) {
+        out = tk.readBool();
+    } else if constexpr (std::is_integral_v<T>) {
+        bool isDouble = false;
+        std::string_view number = tk.readNumber(&isDouble);
+        std::int64_t value = isDouble ? 0 : Tokenizer::toInt(number);
+        bool inRange = !isDouble;
+        if constexpr (std::is_unsigned_v<T>) {
+            // Negative text must not wrap around to a large value.
+            inRange = inRange && value >= 0
+                      && static_cast<std::uint64_t>(value)
+                             <= static_cast<std::uint64_t>(
+                                 std::numeric_limits<T>::max());
+        } else {
+            inRange = inRange
+                      && value >= static_cast<std::int64_t>(
+                             std::numeric_limits<T>::min())
+                      && value <= static_cast<std::int64_t>(
+                             std::numeric_limits<T>::max());
+        }
+        if (!inRange) { throw std::logic_error("value is not integer !"); }
+        out = static_cast<T>(value);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        out = static_cast<T>(Tokenizer::toDouble(tk.readNumber()));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        out.assign(tk.readString());
+    } else if constexpr (std::is_same_v<T, Json>) {
+        out = tk.readValue();
+    } else if constexpr (is_optional<T>::value) {
+        if (tk.peek() == 'n') {
+            tk.readNull();
+            out.reset();
+        } else {
+            read(tk, out.emplace());
+        }
+    } else if constexpr (is_vector<T>::value) {
+        out.clear();
+        tk.expect('[');
+        if (tk.consume(']')) { return; }
+        do { read(tk, out.emplace_back()); } while (tk.consume(','));
+        tk.expect(']');
+    } else if constexpr (is_map<T>::value) {
+        out.clear();
+        tk.expect('{');
+        if (tk.consume('}')) { return; }
+        do {
+            std::string key(tk.readString());
+            tk.expect(':');
+            read(tk, out[key]);
+        } while (tk.consume(','));
+        tk.expect('}');
+    } else if constexpr (is_bound<T>::value) {
+        read_struct(tk, out);
+    } else {
+        static_assert(always_false<T>::value, "type is not bound to JSON");
+    }
+}
+
+template <typename T>
+void write(std::string &out, const T &value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        out += value ? "true" : "false";
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        if constexpr (std::is_floating_point_v<T>) {
+            if (!std::isfinite(value)) {
+                out += "null";
+                return;
+            }
+        }
+        char buf[32];
+        auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, ptr);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        appendQuoted(out, value);
+    } else if constexpr (std::is_same_v<T, Json>) {
+        out += value.stringify();
+    } else if constexpr (is_optional<T>::value) {
+        if (value) {
+            write(out, *value);
+        } else {
+            out += "null";
+        }
+    } else if constexpr (is_vector<T>::value) {
+        out.push_back('[');
+        for (std::size_t i = 0; i < value.size(); i++) {
+            if (i != 0) { out.push_back(','); }
+            write(out, value[i]);
+        }
+        out.push_back(']');
+    } else if constexpr (is_map<T>::value) {
+        out.push_back('{');
+        bool first = true;
+        for (const auto &[k, v] : value) {
+            if (!first) { out.push_back(','); }
+            first = false;
+            appendQuoted(out, k);
+            out.push_back(':');
+            write(out, v);
+        }
+        out.push_back('}');
+    } else if constexpr (is_bound<T>::value) {
+        out.push_back('{');
+        bool first = true;
+        std::apply(
+            [&](const auto &...f) {
+                ((out += first ? "" : ",", first = false,
+                  appendQuoted(out, f.name), out.push_back(':'),
+                  write(out, value.*(f.member))),
+                 ...);
+            },
+            Binder<T>::fields);
+        out.push_back('}');
+    } else {
+        static_assert(always_false<T>::value, "type is not bound to JSON");
+    }
+}
+
+} // namespace bind_detail
+
+//! \brief Parse JSON text straight into out.
+template <typename T>
+void parseInto(std::string_view text, T &out) {
+    Tokenizer tk(text);
+    bind_detail::read(tk, out);
+    if (!tk.done()) { throw std::logic_error("parse is failed ! "); }
+}
+
+//! \brief Parse JSON text straight into a T.
+template <typename T>
+T parseAs(std::string_view text) {
+    T out{};
+    parseInto(text, out);
+    return out;
+}
+
+//! \brief Convert a bound value to JSON text without building a Json.
+template <typename T>
+std::string stringify(const T &value) {
+    std::string out;
+    bind_detail::write(out, value);
+    return out;
+}
+
+} // namespace eee
+
+#define EJSON_BIND_FIELD(T, f) ::eee::field(#f, &T::f)
+#define EJSON_BIND_1(T, a) EJSON_BIND_FIELD(T, a)
+#define EJSON_BIND_2(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_1(T, __VA_ARGS__)
+#define EJSON_BIND_3(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_2(T, __VA_ARGS__)
+#define EJSON_BIND_4(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_3(T, __VA_ARGS__)
+#define EJSON_BIND_5(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_4(T, __VA_ARGS__)
+#define EJSON_BIND_6(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_5(T, __VA_ARGS__)
+#define EJSON_BIND_7(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_6(T, __VA_ARGS__)
+#define EJSON_BIND_8(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_7(T, __VA_ARGS__)
+#define EJSON_BIND_9(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_8(T, __VA_ARGS__)
+#define EJSON_BIND_10(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_9(T, __VA_ARGS__)
+#define EJSON_BIND_11(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_10(T, __VA_ARGS__)
+#define EJSON_BIND_12(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_11(T, __VA_ARGS__)
+#define EJSON_BIND_13(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_12(T, __VA_ARGS__)
+#define EJSON_BIND_14(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_13(T, __VA_ARGS__)
+#define EJSON_BIND_15(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_14(T, __VA_ARGS__)
+#define EJSON_BIND_16(T, a, ...) EJSON_BIND_FIELD(T, a), EJSON_BIND_15(T, __VA_ARGS__)
+#define EJSON_BIND_COUNT(...) \
+    EJSON_BIND_COUNT_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define EJSON_BIND_COUNT_( \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) \
+    N
+#define EJSON_BIND_CAT(a, b)  EJSON_BIND_CAT_(a, b)
+#define EJSON_BIND_CAT_(a, b) a##b
+
+//! \brief Bind the listed members (at most 16) of T to JSON keys of the same
+//! name.
+#define EJSON_BIND(T, ...)                                                     \
+    constexpr auto ejsonFields(T *) {                                          \
+        return std::make_tuple(EJSON_BIND_CAT(                                 \
+            EJSON_BIND_, EJSON_BIND_COUNT(__VA_ARGS__))(T, __VA_ARGS__));      \
+    }
@@ -0,0 +1,286 @@
+#include "cbor.hh"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace eee;
+
+CborWriter::CborWriter(std::string &out) : _out(out) {
+}
+
+void CborWriter::head(std::uint8_t major, std::uint64_t value) {
+    int bytes = 0;
+    std::uint8_t info = 0;
+    if (value < 24) {
+        info = static_cast<std::uint8_t>(value);
+    } else if (value <= 0xff) {
+        info = 24, bytes = 1;
+    } else if (value <= 0xffff) {
+        info = 25, bytes = 2;
+    } else if (value <= 0xffffffff) {
+        info = 26, bytes = 4;
+    } else {
+        info = 27, bytes = 8;
+    }
+    _out.push_back(static_cast<char>((major << 5) | info));
+    for (int i = bytes - 1; i >= 0; i--) {
+        _out.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+    }
+}
+
+void CborWriter::writeNull() {
+    _out.push_back(static_cast<char>(0xf6));
+}
+
+void CborWriter::writeBool(bool value) {
+    _out.push_back(static_cast<char>(value ? 0xf5 : 0xf4));
+}
+
+void CborWriter::writeInt(std::int64_t value) {
+    if (value >= 0) {
+        head(0, static_cast<std::uint64_t>(value));
+    } else {
+        head(1, ~static_cast<std::uint64_t>(value));
+    }
+}
+
+void CborWriter::writeDouble(double value) {
+    // Narrowing a finite double outside the float range is undefined.
+    constexpr double kFloatMax = std::numeric_limits<float>::max();
+    const bool inRange = !std::isfinite(value) || std::fabs(value) <= kFloatMax;
+    auto single = inRange ? static_cast<float>(value) : 0.0f;
+    if ((inRange && static_cast<double>(single) == value)
+        || std::isnan(value)) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &single, sizeof(bits));
+        _out.push_back(static_cast<char>(0xfa));
+        for (int i = 3; i >= 0; i--) {
+            _out.push_back(static_cast<char>((bits >> (i * 8)) & 0xff));
+        }
+        return;
+    }
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    _out.push_back(static_cast<char>(0xfb));
+    for (int i = 7; i >= 0; i--) {
+        _out.push_back(static_cast<char>((bits >> (i * 8)) & 0xff));
+    }
+}
+
+void CborWriter::writeString(std::string_view value) {
+    head(3, value.size());
+    _out.append(value);
+}
+
+void CborWriter::beginArray(std::size_t size) {
+    head(4, size);
+}
+
+void CborWriter::beginMap(std::size_t size) {
+    head(5, size);
+}
+
+void CborWriter::write(const Json &json) {
+    switch (json.type()) {
+        case Type::JSON_NULL:
+            writeNull();
+            break;
+        case Type::JSON_BOOL:
+            writeBool(*json.valueBool());
+            break;
+        case Type::JSON_INT:
+            writeInt(*json.valueInt());
+            break;
+        case Type::JSON_DOUBLE:
+            writeDouble(*json.valueDouble());
+            break;
+        case Type::JSON_STRING:
+            writeString(*json.getString());
+            break;
+        case Type::JSON_ARRAY: {
+            beginArray(json.size().value());
+            if (const auto *ints = json.getIntArray()) {
+                for (int v : *ints) { writeInt(v); }
+            } else if (const auto *doubles = json.getDoubleArray()) {
+                for (double v : *doubles) { writeDouble(v); }
+            } else {
+                for (const auto &v : *json.getArray()) { write(v); }
+            }
+            break;
+        }
+        case Type::JSON_OBJECT: {
+            const auto *obj = json.getObject();
+            beginMap(obj->size());
+            for (const auto &[k, v] : *obj) {
+                writeString(k);
+                write(v);
+            }
+            break;
+        }
+    }
+}
+
+CborReader::CborReader(std::string_view data) : _data(data), _pos(0) {
+}
+
+std::uint64_t CborReader::get(int bytes) {
+    if (_data.size() - _pos < static_cast<std::size_t>(bytes)) {
+        throw std::logic_error("cbor truncated !");
+    }
+    std::uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value = (value << 8) | static_cast<std::uint8_t>(_data[_pos++]);
+    }
+    return value;
+}
+
+std::uint64_t CborReader::argument(std::uint8_t info) {
+    if (info < 24) { return info; }
+    if (info <= 27) { return get(1 << (info - 24)); }
+    throw std::logic_error("cbor argument failed !");
+}
+
+namespace {
+
+double decode_half(std::uint16_t half) {
+    int exp = (half >> 10) & 0x1f;
+    int mant = half & 0x3ff;
+    double value;
+    if (exp == 0) {
+        value = std::ldexp(mant, -24);
+    } else if (exp != 31) {
+        value = std::ldexp(mant + 1024, exp - 25);
+    } else {
+        value = mant == 0 ? INFINITY : NAN;
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+} // namespace
+
+BinaryItem CborReader::next() {
+    BinaryItem item;
+    auto initial = static_cast<std::uint8_t>(get(1));
+    // Tags are skipped in a loop, so a run of them cannot exhaust the stack.
+    while ((initial >> 5) == 6) {
+        argument(initial & 0x1f);
+        initial = static_cast<std::uint8_t>(get(1));
+    }
+    std::uint8_t major = initial >> 5;
+    std::uint8_t info = initial & 0x1f;
+    switch (major) {
+        case 0: {
+            std::uint64_t value = argument(info);
+            if (value > INT64_MAX) {
+                item.type = Type::JSON_DOUBLE;
+                item.number = static_cast<double>(value);
+            } else {
+                item.type = Type::JSON_INT;
+                item.integer = static_cast<std::int64_t>(value);
+            }
+            break;
+        }
+        case 1: {
+            std::uint64_t value = argument(info);
+            if (value > INT64_MAX) {
+                item.type = Type::JSON_DOUBLE;
+                item.number = -1.0 - static_cast<double>(value);
+            } else {
+                item.type = Type::JSON_INT;
+                item.integer = -1 - static_cast<std::int64_t>(value);
+            }
+            break;
+        }
+        case 2:
+        case 3: {
+            if (info == 31) {
+                throw std::logic_error("cbor indefinite string !");
+            }
+            std::uint64_t size = argument(info);
+            if (_data.size() - _pos < size) {
+                throw std::logic_error("cbor truncated !");
+            }
+            item.type = Type::JSON_STRING;
+            item.string = _data.substr(_pos, size);
+            _pos += size;
+            break;
+        }
+        case 4:
+        case 5:
+            item.type = major == 4 ? Type::JSON_ARRAY : Type::JSON_OBJECT;
+            item.size = info == 31 ? BinaryItem::npos : argument(info);
+            // Every element takes at least one byte, reject impossible
+            // counts before anyone reserves memory for them.
+            if (item.size != BinaryItem::npos
+                && item.size > _data.size() - _pos) {
+                throw std::logic_error("cbor truncated !");
+            }
+            break;
+        default:
+            switch (info) {
+                case 20:
+                case 21:
+                    item.type = Type::JSON_BOOL;
+                    item.boolean = info == 21;
+                    break;
+                case 22:
+                case 23:
+                    break;
+                case 25:
+                    item.type = Type::JSON_DOUBLE;
+                    item.number =
+                        decode_half(static_cast<std::uint16_t>(get(2)));
+                    break;
+                case 26: {
+                    auto bits = static_cast<std::uint32_t>(get(4));
+                    float value;
+                    std::memcpy(&value, &bits, sizeof(value));
+                    item.type = Type::JSON_DOUBLE;
+                    item.number = value;
+                    break;
+                }
+                case 27: {
+                    std::uint64_t bits = get(8);
+                    std::memcpy(&item.number, &bits, sizeof(item.number));
+                    item.type = Type::JSON_DOUBLE;
+                    break;
+                }
+                default:
+                    throw std::logic_error("cbor simple value failed !");
+            }
+    }
+    return item;
+}
+
+bool CborReader::nextIsBreak() {
+    if (_pos >= _data.size()) { throw std::logic_error("cbor truncated !"); }
+    if (static_cast<std::uint8_t>(_data[_pos]) != 0xff) { return false; }
+    _pos++;
+    return true;
+}
+
+Json CborReader::read() {
+    return readBinaryJson(*this);
+}
+
+std::size_t CborReader::position() const {
+    return _pos;
+}
+
+bool CborReader::done() const {
+    return _pos == _data.size();
+}
+
+std::string eee::toCbor(const Json &json) {
+    std::string out;
+    CborWriter(out).write(json);
+    return out;
+}
+
+Json eee::fromCbor(std::string_view data) {
+    CborReader reader(data);
+    Json ret = reader.read();
+    if (!reader.done()) { throw std::logic_error("cbor trailing data !"); }
+    return ret;
+}
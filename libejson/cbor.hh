@@ -0,0 +1,79 @@
+#pragma once
+
+#include "binary.hh"
+#include "json.hh"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace eee {
+
+//! \brief Streaming CBOR (RFC 8949) encoder. Values are appended to a caller
+//! owned buffer as they are written; containers are opened with their element
+//! count and their elements are written right after.
+class CborWriter {
+  private:
+    //! \brief Output buffer
+    std::string &_out;
+
+    //! \brief Append an item head with the shortest argument encoding
+    void head(std::uint8_t major, std::uint64_t value);
+
+  public:
+    //! \brief Construct a CborWriter appending to out.
+    explicit CborWriter(std::string &out);
+
+    void writeNull();
+    void writeBool(bool value);
+    void writeInt(std::int64_t value);
+    //! \brief Write a double, as float32 if that is lossless.
+    void writeDouble(double value);
+    void writeString(std::string_view value);
+    //! \brief Open an array, the next size values are its elements.
+    void beginArray(std::size_t size);
+    //! \brief Open a map, the next 2 * size values are its keys and values.
+    void beginMap(std::size_t size);
+    //! \brief Write a complete Json value.
+    void write(const Json &json);
+};
+
+//! \brief Zero-copy CBOR decoder. Items are read one header at a time and
+//! strings are returned as views into the input buffer, which must outlive
+//! them. Tags are skipped, byte strings are surfaced as strings and
+//! indefinite-length arrays and maps are reported with BinaryItem::npos.
+class CborReader {
+  private:
+    //! \brief Encoded input
+    std::string_view _data;
+    //! \brief Offset of the next item
+    std::size_t _pos;
+
+    //! \brief Read a big-endian unsigned integer of the given width
+    std::uint64_t get(int bytes);
+    //! \brief Read the argument of an item head
+    std::uint64_t argument(std::uint8_t info);
+
+  public:
+    //! \brief Construct a CborReader over data.
+    explicit CborReader(std::string_view data);
+
+    //! \brief Decode the next item header.
+    BinaryItem next();
+    //! \brief Consume the "break" ending an indefinite-length container.
+    //! \return 'true' if the next byte was a break
+    bool nextIsBreak();
+    //! \brief Decode one complete value into a Json.
+    Json read();
+    //! \brief Offset of the next item in the input.
+    std::size_t position() const;
+    //! \return 'true' if the whole input has been consumed.
+    bool done() const;
+};
+
+//! \brief Encode a Json as CBOR.
+std::string toCbor(const Json &json);
+//! \brief Decode a CBOR document into a Json.
+Json fromCbor(std::string_view data);
+
+} // namespace eee
@@ -0,0 +1,363 @@
+#include "columns.hh"
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+using namespace eee;
+
+namespace {
+
+using Kind = Column::Kind;
+
+Json number(std::int64_t value) {
+    if (value >= std::numeric_limits<int>::min()
+        && value <= std::numeric_limits<int>::max()) {
+        return Json(static_cast<int>(value));
+    }
+    return Json(static_cast<double>(value));
+}
+
+//! The kind a column of kind from needs to also hold values of kind to.
+Kind fit(Kind from, Kind to) {
+    if (from == Kind::NULLS || from == to) { return to; }
+    if ((from == Kind::INT || from == Kind::DOUBLE)
+        && (to == Kind::INT || to == Kind::DOUBLE)) {
+        return Kind::DOUBLE;
+    }
+    return Kind::JSON;
+}
+
+} // namespace
+
+bool Column::isNull(std::size_t row) const {
+    return (validity[row / 64] >> (row % 64) & 1) == 0;
+}
+
+std::string_view Column::string(std::size_t row) const {
+    if (kind != Kind::STRING || isNull(row)) { return {}; }
+    const std::size_t entry = codes.empty() ? row : codes[row];
+    return std::string_view(chars).substr(
+        offsets[entry], offsets[entry + 1] - offsets[entry]);
+}
+
+Json Column::value(std::size_t row) const {
+    if (isNull(row)) { return Json(); }
+    switch (kind) {
+        case Kind::BOOL:
+            return Json(bools[row] != 0);
+        case Kind::INT:
+            return number(ints[row]);
+        case Kind::DOUBLE:
+            return Json(doubles[row]);
+        case Kind::STRING:
+            return Json(std::string(string(row)));
+        case Kind::JSON:
+            return values[row];
+        default:
+            return Json();
+    }
+}
+
+const Column *Table::column(std::string_view name) const {
+    for (const Column &c : columns) {
+        if (c.name == name) { return &c; }
+    }
+    return nullptr;
+}
+
+ColumnBuilder::ColumnBuilder(bool dictionary)
+    : _columns(), _index(), _codes(), _entries(), _rows(0)
+    , _dictionary(dictionary) {
+}
+
+std::size_t ColumnBuilder::column_of(std::string_view key, std::size_t guess) {
+    // Records usually list their fields in the same order.
+    if (guess < _columns.size() && _columns[guess].name == key) {
+        return guess;
+    }
+    auto it = _index.find(key);
+    if (it != _index.end()) { return it->second; }
+    const std::size_t column = _columns.size();
+    _columns.emplace_back().name = std::string(key);
+    _codes.emplace_back();
+    _entries.push_back(std::make_unique<std::deque<std::string>>());
+    _index.emplace(std::string(key), column);
+    return column;
+}
+
+void ColumnBuilder::pad(Column &c, std::size_t row) {
+    if (c.validity.size() < (row + 63) / 64) {
+        c.validity.resize((row + 63) / 64, 0);
+    }
+    for (; c.size < row; c.size++) {
+        switch (c.kind) {
+            case Kind::BOOL:
+                c.bools.push_back(0);
+                break;
+            case Kind::INT:
+                c.ints.push_back(0);
+                break;
+            case Kind::DOUBLE:
+                c.doubles.push_back(0);
+                break;
+            case Kind::STRING:
+                if (_dictionary) {
+                    c.codes.push_back(0);
+                } else {
+                    c.offsets.push_back(c.chars.size());
+                }
+                break;
+            case Kind::JSON:
+                c.values.emplace_back();
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void ColumnBuilder::widen(Column &c, Kind kind) {
+    kind = fit(c.kind, kind);
+    if (kind == c.kind) { return; }
+    if (c.kind == Kind::NULLS) {
+        // Every row so far is null, give each a placeholder.
+        c.kind = kind;
+        const std::size_t rows = c.size;
+        c.size = 0;
+        if (kind == Kind::STRING) { c.offsets.assign(1, 0); }
+        pad(c, rows);
+        return;
+    }
+    if (kind == Kind::DOUBLE) {
+        c.doubles.assign(c.ints.begin(), c.ints.end());
+        c.ints = std::vector<std::int64_t>();
+        c.kind = kind;
+        return;
+    }
+    std::vector<Json> values;
+    values.reserve(c.size);
+    for (std::size_t row = 0; row < c.size; row++) {
+        values.push_back(c.value(row));
+    }
+    const std::size_t column = static_cast<std::size_t>(&c - _columns.data());
+    _codes[column].clear();
+    _entries[column]->clear();
+    std::string name = std::move(c.name);
+    std::vector<std::uint64_t> validity = std::move(c.validity);
+    const std::size_t size = c.size;
+    c = Column();
+    c.name = std::move(name);
+    c.kind = Kind::JSON;
+    c.size = size;
+    c.validity = std::move(validity);
+    c.values = std::move(values);
+}
+
+void ColumnBuilder::set_valid(Column &c) {
+    if (c.validity.size() <= c.size / 64) {
+        c.validity.resize(c.size / 64 + 1, 0);
+    }
+    c.validity[c.size / 64] |= std::uint64_t(1) << (c.size % 64);
+    c.size++;
+}
+
+void ColumnBuilder::append_string(std::size_t column, std::string_view value) {
+    Column &c = _columns[column];
+    widen(c, Kind::STRING);
+    if (c.kind == Kind::JSON) {
+        c.values.emplace_back(std::string(value));
+    } else if (!_dictionary) {
+        c.chars.append(value);
+        c.offsets.push_back(c.chars.size());
+    } else {
+        auto &codes = _codes[column];
+        auto it = codes.find(value);
+        if (it == codes.end()) {
+            auto code = static_cast<std::uint32_t>(codes.size());
+            const std::string &entry =
+                _entries[column]->emplace_back(value);
+            it = codes.emplace(entry, code).first;
+            c.chars.append(value);
+            c.offsets.push_back(c.chars.size());
+        }
+        c.codes.push_back(it->second);
+    }
+    set_valid(c);
+}
+
+Column &ColumnBuilder::start_value(std::size_t column) {
+    Column &c = _columns[column];
+    if (c.size > _rows) { throw std::logic_error("duplicate key !"); }
+    pad(c, _rows);
+    return c;
+}
+
+void ColumnBuilder::append_bool(std::size_t column, bool value) {
+    Column &c = _columns[column];
+    widen(c, Kind::BOOL);
+    if (c.kind == Kind::JSON) {
+        c.values.emplace_back(value);
+    } else {
+        c.bools.push_back(value);
+    }
+    set_valid(c);
+}
+
+void ColumnBuilder::append_int(std::size_t column, std::int64_t value) {
+    Column &c = _columns[column];
+    widen(c, Kind::INT);
+    if (c.kind == Kind::INT) {
+        c.ints.push_back(value);
+    } else if (c.kind == Kind::DOUBLE) {
+        c.doubles.push_back(static_cast<double>(value));
+    } else {
+        c.values.push_back(number(value));
+    }
+    set_valid(c);
+}
+
+void ColumnBuilder::append_double(std::size_t column, double value) {
+    Column &c = _columns[column];
+    widen(c, Kind::DOUBLE);
+    if (c.kind == Kind::JSON) {
+        c.values.emplace_back(value);
+    } else {
+        c.doubles.push_back(value);
+    }
+    set_valid(c);
+}
+
+void ColumnBuilder::append_json(std::size_t column, Json value) {
+    Column &c = _columns[column];
+    widen(c, Kind::JSON);
+    c.values.push_back(std::move(value));
+    set_valid(c);
+}
+
+void ColumnBuilder::read_value(std::size_t column, Tokenizer &tokens) {
+    Column &c = start_value(column);
+    switch (tokens.peek()) {
+        case 'n':
+            tokens.readNull();
+            pad(c, _rows + 1);
+            break;
+        case 't':
+        case 'f':
+            append_bool(column, tokens.readBool());
+            break;
+        case '"':
+            append_string(column, tokens.readString());
+            break;
+        case '[':
+        case '{':
+            append_json(column, tokens.readValue());
+            break;
+        default: {
+            bool isDouble = false;
+            std::string_view text = tokens.readNumber(&isDouble);
+            std::int64_t value = 0;
+            if (!isDouble) {
+                auto [ptr, ec] = std::from_chars(
+                    text.data(), text.data() + text.size(), value);
+                isDouble = ec != std::errc();
+            }
+            if (isDouble) {
+                append_double(column, Tokenizer::toDouble(text));
+            } else {
+                append_int(column, value);
+            }
+            break;
+        }
+    }
+}
+
+void ColumnBuilder::put_value(std::size_t column, const Json &value) {
+    Column &c = start_value(column);
+    switch (value.type()) {
+        case Type::JSON_NULL:
+            pad(c, _rows + 1);
+            break;
+        case Type::JSON_BOOL:
+            append_bool(column, *value.valueBool());
+            break;
+        case Type::JSON_INT:
+            append_int(column, *value.valueInt());
+            break;
+        case Type::JSON_DOUBLE:
+            append_double(column, *value.valueDouble());
+            break;
+        case Type::JSON_STRING:
+            append_string(column, *value.getString());
+            break;
+        default:
+            append_json(column, value);
+            break;
+    }
+}
+
+void ColumnBuilder::append(Tokenizer &tokens) {
+    tokens.expect('{');
+    if (!tokens.consume('}')) {
+        std::size_t guess = 0;
+        do {
+            const std::size_t column = column_of(tokens.readString(), guess);
+            tokens.expect(':');
+            read_value(column, tokens);
+            guess = column + 1;
+        } while (tokens.consume(','));
+        tokens.expect('}');
+    }
+    _rows++;
+}
+
+void ColumnBuilder::appendArray(std::string_view text) {
+    Tokenizer tokens(text);
+    tokens.expect('[');
+    if (!tokens.consume(']')) {
+        do { append(tokens); } while (tokens.consume(','));
+        tokens.expect(']');
+    }
+    if (!tokens.done()) { throw std::logic_error("parse is failed ! "); }
+}
+
+void ColumnBuilder::appendLines(std::string_view text) {
+    while (!text.empty()) {
+        const std::size_t end = text.find('\n');
+        const std::string_view line = text.substr(0, end);
+        text = end == std::string_view::npos ? std::string_view()
+                                             : text.substr(end + 1);
+        Tokenizer tokens(line);
+        if (tokens.done()) { continue; }
+        append(tokens);
+        if (!tokens.done()) { throw std::logic_error("parse is failed ! "); }
+    }
+}
+
+void ColumnBuilder::append(const Json &record) {
+    if (!record.isObject()) { throw std::logic_error("object failed !"); }
+    std::size_t guess = 0;
+    for (const auto &[key, value] : *record.getObject()) {
+        const std::size_t column = column_of(key, guess);
+        put_value(column, value);
+        guess = column + 1;
+    }
+    _rows++;
+}
+
+std::size_t ColumnBuilder::rows() const {
+    return _rows;
+}
+
+Table ColumnBuilder::finish() {
+    Table table;
+    table.rows = _rows;
+    for (Column &c : _columns) { pad(c, _rows); }
+    table.columns = std::move(_columns);
+    _columns.clear();
+    _index.clear();
+    _codes.clear();
+    _entries.clear();
+    _rows = 0;
+    return table;
+}
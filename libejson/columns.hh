@@ -0,0 +1,137 @@
+#pragma once
+
+#include "json.hh"
+#include "tokenizer.hh"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace eee {
+
+//! \brief One field of a Table, stored as a struct of arrays.
+//!
+//! Which vector holds the values depends on kind. Rows where the field was
+//! null or missing have their bit in validity cleared and a placeholder (0,
+//! false, an empty string) in the value vector, so row i is always at index
+//! i.
+struct Column {
+    //! \brief The type of a column, the narrowest one all its values fit
+    enum class Kind {
+        //! Only nulls so far, no value vector
+        NULLS,
+        BOOL,
+        INT,
+        //! Numbers with a fraction or exponent, or integers mixed with them
+        DOUBLE,
+        STRING,
+        //! Nested or mixed values, kept as Json
+        JSON
+    };
+
+    std::string name;
+    Kind kind = Kind::NULLS;
+    //! \brief Number of rows
+    std::size_t size = 0;
+    //! \brief Bit i % 64 of word i / 64 is set if row i is not null
+    std::vector<std::uint64_t> validity;
+    std::vector<std::uint8_t> bools;
+    std::vector<std::int64_t> ints;
+    std::vector<double> doubles;
+    //! \brief STRING with a dictionary: row i is entry codes[i]. Without a
+    //! dictionary codes is empty and entries are rows.
+    std::vector<std::uint32_t> codes;
+    //! \brief STRING: entry i is chars[offsets[i], offsets[i + 1])
+    std::vector<std::size_t> offsets;
+    std::string chars;
+    std::vector<Json> values;
+
+    //! \return 'true' if row has no value
+    bool isNull(std::size_t row) const;
+    //! \brief The string of row of a STRING column, empty if it is null
+    std::string_view string(std::size_t row) const;
+    //! \brief The value of row as a Json, null if it has none
+    Json value(std::size_t row) const;
+};
+
+//! \brief Records converted to columns, see ColumnBuilder.
+struct Table {
+    std::size_t rows = 0;
+    //! \brief In the order the fields were first seen
+    std::vector<Column> columns;
+
+    //! \return 'nullptr' if there is no column called name
+    const Column *column(std::string_view name) const;
+};
+
+//! \brief Converts a stream of JSON objects into a Table, inferring the
+//! schema as it goes.
+//!
+//! Records are read with a Tokenizer straight into the columns, without a
+//! Json per row. Fields are matched by name, first trying the column after
+//! the previous field, so records with a stable key order cost one string
+//! compare per field. A field seen late is null in the rows before it; a
+//! column whose values stop fitting its kind is widened, INT to DOUBLE and
+//! anything else to JSON.
+class ColumnBuilder {
+  private:
+    std::vector<Column> _columns;
+    //! \brief Column of each field name
+    std::map<std::string, std::size_t, std::less<>> _index;
+    //! \brief Per column, dictionary entries by value. The views point into
+    //! _entries, whose deques are held by pointer so that the entries stay
+    //! put when _entries grows.
+    std::vector<std::unordered_map<std::string_view, std::uint32_t>> _codes;
+    std::vector<std::unique_ptr<std::deque<std::string>>> _entries;
+    std::size_t _rows;
+    bool _dictionary;
+
+    //! \brief Column of the field key of the record being read
+    std::size_t column_of(std::string_view key, std::size_t guess);
+    //! \brief Give c a placeholder for each row before row
+    void pad(Column &c, std::size_t row);
+    //! \brief Change the kind of c to fit values of kind
+    void widen(Column &c, Column::Kind kind);
+    //! \brief Pad column up to the current row, which it must not have yet
+    Column &start_value(std::size_t column);
+    //! \brief Read the value of column in the current row from tokens
+    void read_value(std::size_t column, Tokenizer &tokens);
+    //! \brief Store value in column for the current row
+    void put_value(std::size_t column, const Json &value);
+    void append_bool(std::size_t column, bool value);
+    void append_int(std::size_t column, std::int64_t value);
+    void append_double(std::size_t column, double value);
+    void append_string(std::size_t column, std::string_view value);
+    void append_json(std::size_t column, Json value);
+    //! \brief Mark the row being added to c as not null and count it
+    void set_valid(Column &c);
+
+  public:
+    //! \param dictionary 'true' to store each distinct string of a column
+    //! once and a code per row, 'false' to store every row's string
+    explicit ColumnBuilder(bool dictionary = true);
+
+    //! \brief Read one object from tokens as the next row.
+    //! \throw std::logic_error if it is not an object or repeats a field.
+    //! The row is then partly stored, so the builder should be dropped.
+    void append(Tokenizer &tokens);
+    //! \brief Append the records of a JSON array of objects
+    void appendArray(std::string_view text);
+    //! \brief Append the records of NDJSON text, one object per line
+    void appendLines(std::string_view text);
+    //! \brief Append the object record
+    void append(const Json &record);
+
+    //! \brief Number of rows appended
+    std::size_t rows() const;
+    //! \brief The columns, with every column padded to rows(). The builder
+    //! is empty afterwards.
+    Table finish();
+};
+
+} // namespace eee
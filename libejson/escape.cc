@@ -0,0 +1,128 @@
+#include "escape.hh"
+#include "utf8.hh"
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace eee;
+
+namespace {
+
+const char kHex[] = "0123456789abcdef";
+
+void append_u(std::string &out, std::uint32_t unit) {
+    char buf[6] = {
+        '\\',
+        'u',
+        kHex[(unit >> 12) & 0xf],
+        kHex[(unit >> 8) & 0xf],
+        kHex[(unit >> 4) & 0xf],
+        kHex[unit & 0xf]};
+    out.append(buf, sizeof(buf));
+}
+
+//! Length of the prefix of p that can be copied without escaping. Without
+//! asciiOnly that is scanStringRun(); with it the same scan also stops at
+//! the first byte with the high bit set, so each byte is looked at once.
+std::size_t clean_run(const char *p, std::size_t n, bool asciiOnly) {
+    if (!asciiOnly) { return scanStringRun(p, n, false); }
+    std::size_t i = 0;
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    for (; i + 16 <= n; i += 16) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        // c <= 0x1f as unsigned: max(c, 0x1f) == 0x1f
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(
+                _mm_cmpeq_epi8(c, quote), _mm_cmpeq_epi8(c, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(c, control), control));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(special))
+                    | static_cast<unsigned>(_mm_movemask_epi8(c));
+        if (mask != 0) {
+            return i + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        auto c = static_cast<unsigned char>(p[i]);
+        if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\') { return i; }
+    }
+    return i;
+}
+
+//! Escape the non-ASCII sequence at p as \u units.
+//! \return Number of bytes consumed
+std::size_t escape_utf8(std::string &out, const char *p, std::size_t n) {
+    std::size_t len = utf8Sequence(p, n);
+    if (len == 0) {
+        append_u(out, 0xfffd);
+        return 1;
+    }
+    auto c0 = static_cast<unsigned char>(p[0]);
+    std::uint32_t cp = c0 & (0x7f >> len);
+    for (std::size_t i = 1; i < len; i++) {
+        cp = (cp << 6) | (static_cast<unsigned char>(p[i]) & 0x3f);
+    }
+    if (cp >= 0x10000) {
+        cp -= 0x10000;
+        append_u(out, 0xd800 + (cp >> 10));
+        append_u(out, 0xdc00 + (cp & 0x3ff));
+    } else {
+        append_u(out, cp);
+    }
+    return len;
+}
+
+} // namespace
+
+void eee::appendQuoted(
+    std::string &out, std::string_view value, bool asciiOnly) {
+    out.push_back('"');
+    const char *p = value.data();
+    std::size_t n = value.size();
+    while (n != 0) {
+        std::size_t run = clean_run(p, n, asciiOnly);
+        out.append(p, run);
+        p += run;
+        n -= run;
+        if (n == 0) { break; }
+        auto c = static_cast<unsigned char>(*p);
+        std::size_t used = 1;
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\b':
+                out += "\\b";
+                break;
+            case '\f':
+                out += "\\f";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (c < 0x20) {
+                    append_u(out, c);
+                } else {
+                    used = escape_utf8(out, p, n);
+                }
+        }
+        p += used;
+        n -= used;
+    }
+    out.push_back('"');
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace eee {
+
+//! \brief Append value to out as a quoted JSON string, escaping quotes,
+//! backslashes and control characters. Runs that need no escaping are found
+//! sixteen bytes at a time and copied in bulk.
+//! \param asciiOnly also write every non-ASCII character as a \u escape
+//! (invalid UTF-8 bytes become \\ufffd)
+void appendQuoted(
+    std::string &out, std::string_view value, bool asciiOnly = false);
+
+} // namespace eee
@@ -0,0 +1,243 @@
+#include "incremental.hh"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+using namespace eee;
+
+IncrementalDocument::IncrementalDocument(std::string text)
+    : _text(std::move(text)), _value(), _span(), _valid(false), _error()
+    , _reparsed(0) {
+    parse_all();
+}
+
+Json IncrementalDocument::read(
+    Tokenizer &tokens, Span &span, std::size_t base) {
+    tokens.skipWhitespace();
+    const std::size_t begin = tokens.position();
+    span.begin = begin - base;
+    span.children.clear();
+    Json value;
+    switch (tokens.peek()) {
+        case '[': {
+            tokens.expect('[');
+            std::vector<Json> items;
+            if (!tokens.consume(']')) {
+                do {
+                    Span &child = span.children.emplace_back();
+                    items.push_back(read(tokens, child, begin));
+                } while (tokens.consume(','));
+                tokens.expect(']');
+            }
+            value = Json(std::move(items));
+            break;
+        }
+        case '{': {
+            tokens.expect('{');
+            std::map<std::string, Json> members;
+            if (!tokens.consume('}')) {
+                do {
+                    std::string key(tokens.readString());
+                    tokens.expect(':');
+                    Span &child = span.children.emplace_back();
+                    Json member = read(tokens, child, begin);
+                    auto it = members.find(key);
+                    if (it != members.end()) {
+                        // The last duplicate wins, like Tokenizer::readValue.
+                        for (std::size_t i = span.children.size() - 1;
+                             i-- > 0;) {
+                            Span &earlier = span.children[i];
+                            if (!earlier.shadowed && earlier.key == key) {
+                                earlier.shadowed = true;
+                                break;
+                            }
+                        }
+                        it->second = std::move(member);
+                    } else {
+                        members.emplace(key, std::move(member));
+                    }
+                    child.key = std::move(key);
+                } while (tokens.consume(','));
+                tokens.expect('}');
+            }
+            value = Json(std::move(members));
+            break;
+        }
+        default:
+            value = tokens.readValue();
+            break;
+    }
+    span.length = tokens.position() - begin;
+    return value;
+}
+
+bool IncrementalDocument::parse_all() {
+    _reparsed = _text.size();
+    Tokenizer tokens(_text);
+    Span span;
+    Json value;
+    try {
+        value = read(tokens, span, 0);
+        if (!tokens.done()) { throw std::logic_error("parse is failed ! "); }
+    } catch (std::logic_error &e) {
+        _valid = false;
+        _error = e.what();
+        return false;
+    }
+    _span = std::move(span);
+    _value = std::move(value);
+    _valid = true;
+    _error.clear();
+    return true;
+}
+
+bool IncrementalDocument::reparse(
+    std::vector<Frame> &path, std::size_t depth, long delta) {
+    Span &old = *path[depth].span;
+    const std::size_t base = path[depth].base;
+    const std::size_t begin = base + old.begin;
+    const std::size_t end =
+        static_cast<std::size_t>(static_cast<long>(begin + old.length) + delta);
+    // The value must end exactly where its span now ends.
+    Tokenizer tokens(std::string_view(_text).substr(0, end));
+    tokens.seek(begin);
+    Span span;
+    Json value;
+    try {
+        value = read(tokens, span, base);
+    } catch (std::logic_error &) { return false; }
+    if (tokens.position() != end) { return false; }
+    _reparsed = end - begin;
+
+    span.key = std::move(old.key);
+    old = std::move(span);
+    // Grow the ancestors and move the siblings that follow on each level.
+    for (std::size_t i = depth; i > 0; i--) {
+        Span &parent = *path[i - 1].span;
+        parent.length = static_cast<std::size_t>(
+            static_cast<long>(parent.length) + delta);
+        for (std::size_t j = path[i].index + 1; j < parent.children.size();
+             j++) {
+            Span &sibling = parent.children[j];
+            sibling.begin = static_cast<std::size_t>(
+                static_cast<long>(sibling.begin) + delta);
+        }
+    }
+    Json *node = &_value;
+    for (std::size_t i = 1; i <= depth; i++) {
+        const Span &child = path[i - 1].span->children[path[i].index];
+        node = node->isArray() ? &(*node)[path[i].index]
+                               : &(*node)[child.key];
+    }
+    *node = std::move(value);
+    return true;
+}
+
+bool IncrementalDocument::edit(
+    std::size_t offset, std::size_t removed, std::string_view inserted) {
+    if (offset > _text.size() || removed > _text.size() - offset) {
+        throw std::out_of_range("edit out of range !");
+    }
+    _text.replace(offset, removed, inserted);
+    if (!_valid) { return parse_all(); }
+    const long delta =
+        static_cast<long>(inserted.size()) - static_cast<long>(removed);
+
+    // Spans from the root down to the deepest value containing the edit.
+    std::vector<Frame> path;
+    if (_span.begin <= offset
+        && offset + removed <= _span.begin + _span.length) {
+        path.push_back(Frame{&_span, 0, 0});
+    }
+    while (!path.empty()) {
+        Span &span = *path.back().span;
+        const std::size_t base = path.back().base + span.begin;
+        const std::size_t at = offset - base;
+        auto it = std::upper_bound(
+            span.children.begin(), span.children.end(), at,
+            [](std::size_t value, const Span &child) {
+                return value < child.begin;
+            });
+        if (it == span.children.begin()) { break; }
+        Span &child = *--it;
+        if (child.shadowed || at + removed > child.begin + child.length) {
+            break;
+        }
+        path.push_back(Frame{
+            &child, static_cast<std::size_t>(it - span.children.begin()),
+            base});
+    }
+    // The root is re-parsed as the whole text, which also checks what
+    // surrounds it.
+    for (std::size_t depth = path.size(); depth-- > 1;) {
+        if (reparse(path, depth, delta)) { return true; }
+    }
+    return parse_all();
+}
+
+const Json &IncrementalDocument::value() const {
+    return _value;
+}
+
+const std::string &IncrementalDocument::text() const {
+    return _text;
+}
+
+bool IncrementalDocument::valid() const {
+    return _valid;
+}
+
+const std::string &IncrementalDocument::error() const {
+    return _error;
+}
+
+std::size_t IncrementalDocument::lastReparsed() const {
+    return _reparsed;
+}
+
+std::optional<std::pair<std::size_t, std::size_t>>
+IncrementalDocument::span(std::string_view pointer) const {
+    if (!_valid) { return std::nullopt; }
+    const Span *span = &_span;
+    const Json *node = &_value;
+    std::size_t begin = _span.begin;
+    while (!pointer.empty()) {
+        if (pointer[0] != '/') { return std::nullopt; }
+        pointer.remove_prefix(1);
+        const std::size_t end = std::min(pointer.find('/'), pointer.size());
+        std::string token;
+        for (std::size_t i = 0; i < end; i++) {
+            if (pointer[i] == '~' && i + 1 < end
+                && (pointer[i + 1] == '0' || pointer[i + 1] == '1')) {
+                token.push_back(pointer[++i] == '0' ? '~' : '/');
+            } else {
+                token.push_back(pointer[i]);
+            }
+        }
+        pointer.remove_prefix(end);
+        const Span *next = nullptr;
+        if (node->isArray()) {
+            std::size_t index = 0;
+            for (char c : token) {
+                if (c < '0' || c > '9') { return std::nullopt; }
+                index = index * 10 + static_cast<std::size_t>(c - '0');
+            }
+            if (token.empty() || index >= span->children.size()) {
+                return std::nullopt;
+            }
+            next = &span->children[index];
+            node = &(*node)[index];
+        } else if (node->isObject()) {
+            for (const Span &child : span->children) {
+                if (!child.shadowed && child.key == token) { next = &child; }
+            }
+            if (next == nullptr) { return std::nullopt; }
+            node = &(*node)[token];
+        } else {
+            return std::nullopt;
+        }
+        span = next;
+        begin += span->begin;
+    }
+    return std::make_pair(begin, begin + span->length);
+}
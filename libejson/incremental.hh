@@ -0,0 +1,96 @@
+#pragma once
+
+#include "json.hh"
+#include "tokenizer.hh"
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace eee {
+
+//! \brief JSON text kept together with its Json tree, re-parsed locally
+//! after edits.
+//!
+//! Every value of the tree has a source span. edit() changes the text and
+//! then re-parses only the deepest value whose span contains the edit,
+//! replacing that subtree of value() in place. If the new text of that span
+//! is not exactly one value, the enclosing values are tried in turn, up to
+//! the whole text. Spans are stored relative to their parent, so shifting
+//! the nodes after an edit touches only the later siblings on its path,
+//! and the cost of an edit follows the size of the value it falls in rather
+//! than the document.
+class IncrementalDocument {
+  private:
+    //! \brief Source range of one value
+    struct Span {
+        //! \brief Offset from the begin of the parent, absolute for the root
+        std::size_t begin = 0;
+        std::size_t length = 0;
+        //! \brief Member name when the parent is an object
+        std::string key;
+        //! \brief A member overridden by a later one with the same key, so
+        //! absent from the Json tree
+        bool shadowed = false;
+        //! \brief Elements or members in text order
+        std::vector<Span> children;
+    };
+    //! \brief A span on the path to an edit
+    struct Frame {
+        Span *span;
+        //! \brief Index in the parent's children
+        std::size_t index;
+        //! \brief Absolute begin of the parent
+        std::size_t base;
+    };
+
+    std::string _text;
+    Json _value;
+    Span _span;
+    bool _valid;
+    std::string _error;
+    //! \brief Bytes parsed by the last edit
+    std::size_t _reparsed;
+
+    //! \brief Read a value with its spans, relative to base
+    static Json read(Tokenizer &tokens, Span &span, std::size_t base);
+    //! \brief Parse all of _text
+    bool parse_all();
+    //! \brief Re-parse path[depth] after an edit that changed its length by
+    //! delta, and patch it in.
+    //! \return 'false' if its new text is not exactly one value
+    bool reparse(std::vector<Frame> &path, std::size_t depth, long delta);
+
+  public:
+    //! \brief Parse text. If it is not valid JSON, valid() is 'false' until
+    //! an edit makes it valid.
+    explicit IncrementalDocument(std::string text);
+
+    //! \brief Replace removed bytes at offset with inserted and bring value()
+    //! up to date.
+    //! \return 'false' if the text is no longer valid JSON; value() then
+    //! keeps the last valid tree and the next edit parses the whole text.
+    //! \throw std::out_of_range if the edit is outside the text
+    bool edit(
+        std::size_t offset, std::size_t removed, std::string_view inserted);
+
+    //! \brief The tree of the last valid text
+    const Json &value() const;
+    //! \brief The current text
+    const std::string &text() const;
+    //! \return 'false' if the current text is not valid JSON
+    bool valid() const;
+    //! \brief Why the current text is not valid, empty when it is
+    const std::string &error() const;
+    //! \brief Number of bytes parsed by the last edit or construction
+    std::size_t lastReparsed() const;
+    //! \brief Source range [begin, end) of the value at pointer, a JSON
+    //! Pointer (RFC 6901) such as "/servers/0/port".
+    //! \return 'nullopt' if there is no such value or the text is invalid
+    std::optional<std::pair<std::size_t, std::size_t>>
+    span(std::string_view pointer) const;
+};
+
+} // namespace eee
@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <numeric>
 #include <optional>
 #include <ostream>
 #include <stdexcept>
@@ -9,6 +12,7 @@
 #include <utility>
 #include <variant>
 
+#include "escape.hh"
 #include "json.hh"
 using namespace eee;
 
@@ -20,6 +24,19 @@ using str_ptr = std::unique_ptr<string>;
 using arr_ptr = std::unique_ptr<array>;
 using obj_ptr = std::unique_ptr<object>;
 
+namespace {
+
+//! Find key in members without a temporary std::string: the key is copied
+//! into a per-thread buffer, which allocates only when it has to grow.
+template <typename Members>
+auto find_key(Members &members, std::string_view key) {
+    thread_local std::string scratch;
+    scratch.assign(key.data(), key.size());
+    return members.find(scratch);
+}
+
+} // namespace
+
 Json::Json() : _type{Type::JSON_NULL}, _value{nullptr} {
 }
 
@@ -69,6 +86,11 @@ Json::Json(const string &value)
     : _type{Type::JSON_STRING}, _value{std::make_unique<string>(value)} {
 }
 
+Json::Json(string &&value)
+    : _type{Type::JSON_STRING}
+    , _value{std::make_unique<string>(std::move(value))} {
+}
+
 Json::Json(const std::vector<Json> &value)
     : _type{Type::JSON_ARRAY}, _value{std::make_unique<array>(value)} {
 }
@@ -77,6 +99,26 @@ Json::Json(const std::map<std::string, Json> &value)
     : _type{Type::JSON_OBJECT}, _value{std::make_unique<object>(value)} {
 }
 
+Json::Json(std::vector<Json> &&value)
+    : _type{Type::JSON_ARRAY}
+    , _value{std::make_unique<array>(std::move(value))} {
+}
+
+Json::Json(std::map<std::string, Json> &&value)
+    : _type{Type::JSON_OBJECT}
+    , _value{std::make_unique<object>(std::move(value))} {
+}
+
+Json::Json(std::vector<int> &&value)
+    : _type{Type::JSON_ARRAY}
+    , _value{std::make_unique<Numbers<int>>(std::move(value))} {
+}
+
+Json::Json(std::vector<double> &&value)
+    : _type{Type::JSON_ARRAY}
+    , _value{std::make_unique<Numbers<double>>(std::move(value))} {
+}
+
 Json::Json(const Json &value) {
     copy(value);
 }
@@ -86,6 +128,13 @@ Json::Json(Json &&other) noexcept {
     other._value.swap(_value);
     _type = other._type;
     other._type = Type::JSON_NULL;
+    // The cache moves with the value it describes. The emptied slot is a
+    // change to the values holding it.
+    _cache = std::move(other._cache);
+    if (_cache) {
+        if (_cache->parent != nullptr) { _cache->parent->invalidate(); }
+        _cache->parent = nullptr;
+    }
 }
 
 Json::~Json() {
@@ -103,6 +152,15 @@ Json &Json::operator=(Json &&other) noexcept {
     other._value.swap(_value);
     _type = other._type;
     other._type = Type::JSON_NULL;
+    // The cache moves with the value it describes, the link to the parent
+    // stays with this slot.
+    if (other._cache) {
+        if (other._cache->parent != nullptr) {
+            other._cache->parent->invalidate();
+        }
+        other._cache->parent = _cache ? _cache->parent : nullptr;
+        _cache = std::move(other._cache);
+    }
     return *this;
 }
 
@@ -113,7 +171,13 @@ void Json::copy(const Json &other) {
             _value = std::make_unique<string>(*std::get<str_ptr>(other._value));
             break;
         case Type::JSON_ARRAY:
-            _value = std::make_unique<array>(*std::get<arr_ptr>(other._value));
+            if (const auto *ints = other.getIntArray()) {
+                _value = std::make_unique<Numbers<int>>(*ints);
+            } else if (const auto *doubles = other.getDoubleArray()) {
+                _value = std::make_unique<Numbers<double>>(*doubles);
+            } else {
+                _value = std::make_unique<array>(*std::get<arr_ptr>(other._value));
+            }
             break;
         case Type::JSON_OBJECT:
             _value = std::make_unique<object>(*std::get<obj_ptr>(other._value));
@@ -134,13 +198,109 @@ void Json::copy(const Json &other) {
 }
 
 void Json::clear() {
+    touch();
     _value = nullptr;
     _type = Type::JSON_NULL;
 }
 
 void Json::swap(Json &other) {
+    touch();
+    other.touch();
+    Cache *parent = _cache ? _cache->parent : nullptr;
+    Cache *otherParent = other._cache ? other._cache->parent : nullptr;
     other._value.swap(_value);
     std::swap(other._type, _type);
+    other._cache.swap(_cache);
+    // Links to the parents stay with the slots.
+    if (_cache) { _cache->parent = parent; }
+    if (other._cache) { other._cache->parent = otherParent; }
+}
+
+array &Json::elements() {
+    if (const auto *ints = getIntArray()) {
+        _value = std::make_unique<array>(ints->begin(), ints->end());
+    } else if (const auto *doubles = getDoubleArray()) {
+        _value = std::make_unique<array>(doubles->begin(), doubles->end());
+    }
+    return *std::get<arr_ptr>(_value);
+}
+
+template <typename T>
+const array &Json::Numbers<T>::json() const {
+    array *built = view.load(std::memory_order_acquire);
+    if (built != nullptr) { return *built; }
+    auto fresh = std::make_unique<array>(values.begin(), values.end());
+    // Of readers building it at once, the first to publish wins.
+    if (view.compare_exchange_strong(
+            built, fresh.get(), std::memory_order_acq_rel)) {
+        return *fresh.release();
+    }
+    return *built;
+}
+
+void Json::Cache::invalidate() {
+    for (Cache *cache = this; cache != nullptr; cache = cache->parent) {
+        cache->valid = false;
+        cache->hashValid = false;
+    }
+}
+
+void Json::touch() const {
+    if (_cache) {
+        _cache->indexValid = false;
+        _cache->invalidate();
+    }
+}
+
+void Json::adopt(Cache *cache) const {
+    auto link = [cache](const Json &child) {
+        if (!child._cache) { child._cache = std::make_unique<Cache>(); }
+        child._cache->parent = cache;
+    };
+    if (_type == Type::JSON_ARRAY && getArray() != nullptr) {
+        for (const auto &v : *getArray()) { link(v); }
+    } else if (_type == Type::JSON_OBJECT) {
+        for (const auto &[k, v] : *std::get<obj_ptr>(_value)) { link(v); }
+    }
+}
+
+void Json::enableCache() {
+    switch (_type) {
+        case Type::JSON_ARRAY:
+            if (!_cache) { _cache = std::make_unique<Cache>(); }
+            if (getArray() == nullptr) { break; }
+            for (auto &v : *std::get<arr_ptr>(_value)) { v.enableCache(); }
+            break;
+        case Type::JSON_OBJECT:
+            if (!_cache) { _cache = std::make_unique<Cache>(); }
+            for (auto &[k, v] : *std::get<obj_ptr>(_value)) {
+                v.enableCache();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Json::disableCache() {
+    if (_cache && _cache->parent != nullptr) { _cache->parent->invalidate(); }
+    _cache.reset();
+    // Unlink the children first, the cache they point to is gone.
+    auto drop = [](Json &child) {
+        if (child._cache) { child._cache->parent = nullptr; }
+        child.disableCache();
+    };
+    switch (_type) {
+        case Type::JSON_ARRAY:
+            if (getArray() == nullptr) { break; }
+            for (auto &v : *std::get<arr_ptr>(_value)) { drop(v); }
+            break;
+        case Type::JSON_OBJECT:
+            for (auto &[k, v] : *std::get<obj_ptr>(_value)) { drop(v); }
+            break;
+        default:
+            break;
+    }
 }
 
 Json &Json::operator=(std::nullptr_t value) {
@@ -191,15 +351,51 @@ Json &Json::operator=(const object &value) {
     return *this;
 }
 
+namespace {
+
+//! Numeric storage against Json elements, which must have the matching type.
+template <typename T>
+bool numbers_equal(const std::vector<T> &numbers, const array &values) {
+    if (numbers.size() != values.size()) { return false; }
+    for (std::size_t i = 0; i < numbers.size(); i++) {
+        if (!(values[i] == Json(numbers[i]))) { return false; }
+    }
+    return true;
+}
+
+bool arrays_equal(const Json &a, const Json &b) {
+    if (a.size() != b.size()) { return false; }
+    if (a.size() == 0) { return true; }
+    const auto *ints = a.getIntArray();
+    const auto *doubles = a.getDoubleArray();
+    const auto *values = a.getArray();
+    if (ints && b.getIntArray()) { return *ints == *b.getIntArray(); }
+    if (doubles && b.getDoubleArray()) {
+        return *doubles == *b.getDoubleArray();
+    }
+    if (values && b.getArray()) { return *values == *b.getArray(); }
+    // Different storage: only numeric against generic can still match.
+    if (values) { return arrays_equal(b, a); }
+    if (b.getArray() == nullptr) { return false; }
+    return ints ? numbers_equal(*ints, *b.getArray())
+                : numbers_equal(*doubles, *b.getArray());
+}
+
+} // namespace
+
 bool Json::equal(const Json &other) const {
     if (_type != other._type) { return false; }
+    if (this == &other) { return true; }
+    if (_cache && other._cache && _cache->hashValid && other._cache->hashValid
+        && _cache->hash != other._cache->hash) {
+        return false;
+    }
     switch (_type) {
         case Type::JSON_STRING:
             return *(std::get<str_ptr>(_value))
                    == *(std::get<str_ptr>(other._value));
         case Type::JSON_ARRAY:
-            return *(std::get<arr_ptr>(_value))
-                   == *(std::get<arr_ptr>(other._value));
+            return arrays_equal(*this, other);
         case Type::JSON_OBJECT:
             return *(std::get<obj_ptr>(_value))
                    == *(std::get<obj_ptr>(other._value));
@@ -209,6 +405,105 @@ bool Json::equal(const Json &other) const {
     return false;
 }
 
+namespace {
+
+constexpr std::uint64_t kHashMul = 0x9e3779b97f4a7c15ULL;
+
+std::uint64_t hash_mix(std::uint64_t x) {
+    x ^= x >> 32;
+    x *= 0xd6e8feb86659fd93ULL;
+    x ^= x >> 32;
+    x *= 0xd6e8feb86659fd93ULL;
+    x ^= x >> 32;
+    return x;
+}
+
+std::uint64_t hash_combine(std::uint64_t seed, std::uint64_t value) {
+    return hash_mix(seed ^ (value + kHashMul + (seed << 6) + (seed >> 2)));
+}
+
+//! Eight bytes at a time, independent of std::hash so results are stable.
+std::uint64_t hash_bytes(std::string_view s, std::uint64_t seed) {
+    std::uint64_t h = seed ^ (s.size() * kHashMul);
+    std::size_t i = 0;
+    for (; i + 8 <= s.size(); i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, s.data() + i, sizeof(word));
+        h = hash_mix(h ^ word) * kHashMul;
+    }
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, s.data() + i, s.size() - i);
+    return hash_mix(h ^ tail);
+}
+
+//! Hash of an object key for the member index, see JsonKey.
+std::size_t key_hash(std::string_view name) {
+    return static_cast<std::size_t>(hash_bytes(name, kHashMul));
+}
+
+} // namespace
+
+std::size_t Json::hash() const {
+    if (_cache && _cache->hashValid) { return _cache->hash; }
+    const bool cached = _cache && (isArray() || isObject());
+    if (cached) { adopt(_cache.get()); }
+    std::uint64_t h = static_cast<std::uint64_t>(_type) + 1;
+    switch (_type) {
+        case Type::JSON_NULL:
+            h = hash_mix(h);
+            break;
+        case Type::JSON_BOOL:
+            h = hash_combine(h, std::get<bool>(_value));
+            break;
+        case Type::JSON_INT:
+            h = hash_combine(
+                h, static_cast<std::uint64_t>(std::get<int>(_value)));
+            break;
+        case Type::JSON_DOUBLE: {
+            // 0.0 == -0.0, so they must hash alike
+            double d = std::get<double>(_value);
+            if (d == 0.0) { d = 0.0; }
+            std::uint64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            h = hash_combine(h, bits);
+            break;
+        }
+        case Type::JSON_STRING:
+            h = hash_bytes(*std::get<str_ptr>(_value), h);
+            break;
+        case Type::JSON_ARRAY:
+            // Numeric storage hashes like the equal Json elements.
+            if (const auto *ints = getIntArray()) {
+                for (int v : *ints) { h = hash_combine(h, Json(v).hash()); }
+            } else if (const auto *doubles = getDoubleArray()) {
+                for (double v : *doubles) {
+                    h = hash_combine(h, Json(v).hash());
+                }
+            } else {
+                for (const auto &v : *std::get<arr_ptr>(_value)) {
+                    h = hash_combine(h, v.hash());
+                }
+            }
+            h = hash_combine(h, size().value());
+            break;
+        case Type::JSON_OBJECT: {
+            // Sum of member hashes, so member order does not matter.
+            std::uint64_t sum = 0;
+            for (const auto &[k, v] : *std::get<obj_ptr>(_value)) {
+                sum += hash_combine(hash_bytes(k, kHashMul), v.hash());
+            }
+            h = hash_combine(h, sum);
+            h = hash_combine(h, std::get<obj_ptr>(_value)->size());
+            break;
+        }
+    }
+    if (cached) {
+        _cache->hash = h;
+        _cache->hashValid = true;
+    }
+    return h;
+}
+
 bool Json::operator==(const Json &other) const {
     return equal(other);
 }
@@ -270,6 +565,12 @@ std::optional<std::string> Json::valueString() const {
 }
 
 std::optional<array> Json::valueArray() const {
+    if (const auto *ints = getIntArray()) {
+        return array(ints->begin(), ints->end());
+    }
+    if (const auto *doubles = getDoubleArray()) {
+        return array(doubles->begin(), doubles->end());
+    }
     if (_type == Type::JSON_ARRAY) { return *(std::get<arr_ptr>(_value)); }
     return std::nullopt;
 }
@@ -279,6 +580,35 @@ std::optional<object> Json::valueObject() const {
     return std::nullopt;
 }
 
+const std::string *Json::getString() const {
+    if (_type == Type::JSON_STRING) { return std::get<str_ptr>(_value).get(); }
+    return nullptr;
+}
+
+const array *Json::getArray() const {
+    if (const auto *p = std::get_if<arr_ptr>(&_value)) { return p->get(); }
+    return nullptr;
+}
+
+const std::vector<int> *Json::getIntArray() const {
+    if (const auto *p = std::get_if<ints_ptr>(&_value)) {
+        return &(*p)->values;
+    }
+    return nullptr;
+}
+
+const std::vector<double> *Json::getDoubleArray() const {
+    if (const auto *p = std::get_if<doubles_ptr>(&_value)) {
+        return &(*p)->values;
+    }
+    return nullptr;
+}
+
+const object *Json::getObject() const {
+    if (_type == Type::JSON_OBJECT) { return std::get<obj_ptr>(_value).get(); }
+    return nullptr;
+}
+
 std::optional<std::size_t> Json::length() const {
     if (_type == Type::JSON_STRING) {
         return std::get<str_ptr>(_value)->length();
@@ -291,6 +621,10 @@ std::optional<std::size_t> Json::size() const {
         case Type::JSON_STRING:
             return std::get<str_ptr>(_value)->size();
         case Type::JSON_ARRAY:
+            if (const auto *ints = getIntArray()) { return ints->size(); }
+            if (const auto *doubles = getDoubleArray()) {
+                return doubles->size();
+            }
             return std::get<arr_ptr>(_value)->size();
         case Type::JSON_OBJECT:
             return std::get<obj_ptr>(_value)->size();
@@ -298,32 +632,105 @@ std::optional<std::size_t> Json::size() const {
     return std::nullopt;
 }
 
-Json &Json::operator[](const std::size_t index) const {
-    return std::get<arr_ptr>(_value)->at(index);
+Json &Json::operator[](const std::size_t index) {
+    touch();
+    return elements().at(index);
 }
 
-Json &Json::operator[](const char *key) const {
-    return (*this)[std::string(key)];
+Json &Json::operator[](const char *key) {
+    touch();
+    object &members = *std::get<obj_ptr>(_value);
+    auto it = find_key(members, key);
+    if (it != members.end()) { return it->second; }
+    return members[std::string(key)];
 }
 
-Json &Json::operator[](const std::string &key) const {
+Json &Json::operator[](const std::string &key) {
+    touch();
     return (*std::get<obj_ptr>(_value))[key];
 }
 
+const Json &Json::operator[](const std::size_t index) const {
+    if (const auto *ints = std::get_if<ints_ptr>(&_value)) {
+        return (*ints)->json().at(index);
+    }
+    if (const auto *doubles = std::get_if<doubles_ptr>(&_value)) {
+        return (*doubles)->json().at(index);
+    }
+    return std::get<arr_ptr>(_value)->at(index);
+}
+
+const Json &Json::operator[](const char *key) const {
+    const Json *member = get(key);
+    if (member == nullptr) { throw std::out_of_range("map::at"); }
+    return *member;
+}
+
+const Json &Json::operator[](const std::string &key) const {
+    return std::get<obj_ptr>(_value)->at(key);
+}
+
 void Json::push_back(const Json &other) {
-    std::get<arr_ptr>(_value)->push_back(other);
+    touch();
+    // Numbers of the stored type keep numeric storage.
+    if (auto *ints = std::get_if<ints_ptr>(&_value); ints && other.isInt()) {
+        (*ints)->values.push_back(*other.valueInt());
+        (*ints)->changed();
+        return;
+    }
+    if (auto *doubles = std::get_if<doubles_ptr>(&_value);
+        doubles && other.isDouble()) {
+        (*doubles)->values.push_back(*other.valueDouble());
+        (*doubles)->changed();
+        return;
+    }
+    elements().push_back(other);
 }
 
 void Json::insert(std::pair<const char *, Json> k_v) {
-    std::get<obj_ptr>(_value)->insert({std::string(k_v.first), k_v.second});
+    touch();
+    std::get<obj_ptr>(_value)->insert(
+        {std::string(k_v.first), std::move(k_v.second)});
 }
 
 void Json::insert(std::pair<const std::string &, Json> k_v) {
-    std::get<obj_ptr>(_value)->insert(k_v);
+    touch();
+    std::get<obj_ptr>(_value)->insert({k_v.first, std::move(k_v.second)});
+}
+
+void Json::insert(const std::size_t index, Json value) {
+    touch();
+    if (auto *ints = std::get_if<ints_ptr>(&_value); ints && value.isInt()) {
+        auto &values = (*ints)->values;
+        values.insert(values.begin() + index, *value.valueInt());
+        (*ints)->changed();
+        return;
+    }
+    if (auto *doubles = std::get_if<doubles_ptr>(&_value);
+        doubles && value.isDouble()) {
+        auto &values = (*doubles)->values;
+        values.insert(values.begin() + index, *value.valueDouble());
+        (*doubles)->changed();
+        return;
+    }
+    std::vector<Json> &items = elements();
+    items.insert(items.begin() + index, std::move(value));
 }
 
 void Json::erase(const std::size_t index) {
-    auto sz = std::get<arr_ptr>(_value)->size();
+    touch();
+    if (auto *ints = std::get_if<ints_ptr>(&_value)) {
+        auto &values = (*ints)->values;
+        values.erase(values.begin() + index);
+        (*ints)->changed();
+        return;
+    }
+    if (auto *doubles = std::get_if<doubles_ptr>(&_value)) {
+        auto &values = (*doubles)->values;
+        values.erase(values.begin() + index);
+        (*doubles)->changed();
+        return;
+    }
     std::get<arr_ptr>(_value)->erase(
         std::get<arr_ptr>(_value)->begin() + index);
 }
@@ -333,36 +740,158 @@ void Json::erase(const char *key) {
 }
 
 void Json::erase(const std::string &key) {
+    touch();
     std::get<obj_ptr>(_value)->erase(key);
 }
 
 bool Json::empty() const {
     switch (_type) {
         case Type::JSON_ARRAY:
-            return std::get<arr_ptr>(_value)->empty();
+            return size().value() == 0;
         case Type::JSON_OBJECT:
             return std::get<obj_ptr>(_value)->empty();
     }
 }
 
-std::map<std::string, Json>::iterator Json::find(const char *key) const {
-    return find(std::string(key));
+std::map<std::string, Json>::iterator Json::find(const char *key) {
+    return find(std::string_view(key));
 }
 
-std::map<std::string, Json>::iterator Json::find(const std::string &key) const {
+std::map<std::string, Json>::iterator Json::find(const std::string &key) {
+    touch();
     return std::get<obj_ptr>(_value)->find(key);
 }
 
-std::string Json::stringify() const {
-    return Json::pstringify(0, false);
+std::map<std::string, Json>::const_iterator
+Json::find(const char *key) const {
+    return find(std::string_view(key));
+}
+
+std::map<std::string, Json>::const_iterator
+Json::find(const std::string &key) const {
+    return std::get<obj_ptr>(_value)->find(key);
 }
 
-std::string Json::fmtStringify() const {
-    return Json::pstringify(0, true);
+std::map<std::string, Json>::iterator Json::find(std::string_view key) {
+    touch();
+    return find_key(*std::get<obj_ptr>(_value), key);
 }
 
-std::string Json::pstringify(std::size_t spaceNum, bool isFmt) const {
-    string ret{};
+std::map<std::string, Json>::const_iterator
+Json::find(std::string_view key) const {
+    return find_key(
+        static_cast<const object &>(*std::get<obj_ptr>(_value)), key);
+}
+
+const Json *Json::get(std::string_view key) const {
+    if (_type != Type::JSON_OBJECT) { return nullptr; }
+    const object &members = *std::get<obj_ptr>(_value);
+    auto it = find_key(members, key);
+    return it == members.end() ? nullptr : &it->second;
+}
+
+const Json *Json::find(const JsonKey &key) const {
+    if (_type != Type::JSON_OBJECT) { return nullptr; }
+    const object &members = *std::get<obj_ptr>(_value);
+    if (!_cache || members.size() < kIndexedSize) {
+        auto it = members.find(key.name());
+        return it == members.end() ? nullptr : &it->second;
+    }
+    std::vector<Cache::Slot> &index = _cache->index;
+    if (!_cache->indexValid) {
+        std::size_t size = 1;
+        while (size < 2 * members.size()) { size <<= 1; }
+        index.assign(size, Cache::Slot{});
+        for (const auto &[name, value] : members) {
+            const std::size_t h = key_hash(name);
+            std::size_t i = h & (size - 1);
+            while (index[i].value != nullptr) { i = (i + 1) & (size - 1); }
+            index[i] = Cache::Slot{h, &name, &value};
+        }
+        _cache->indexValid = true;
+    }
+    const std::size_t mask = index.size() - 1;
+    for (std::size_t i = key.hash() & mask; index[i].value != nullptr;
+         i = (i + 1) & mask) {
+        if (index[i].hash == key.hash() && *index[i].name == key.name()) {
+            return index[i].value;
+        }
+    }
+    return nullptr;
+}
+
+void Json::findAll(
+    const std::string_view *keys, std::size_t count, const Json **out) const {
+    if (_type != Type::JSON_OBJECT) {
+        std::fill(out, out + count, nullptr);
+        return;
+    }
+    const object &members = *std::get<obj_ptr>(_value);
+    // A few keys are cheaper to look up than a walk over every member.
+    std::size_t depth = 1;
+    while ((std::size_t(1) << depth) < members.size()) { depth++; }
+    if (count * depth < members.size()) {
+        for (std::size_t i = 0; i < count; i++) { out[i] = get(keys[i]); }
+        return;
+    }
+    thread_local std::vector<std::size_t> order;
+    order.resize(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return keys[a] < keys[b];
+    });
+    auto it = members.begin();
+    for (std::size_t i : order) {
+        while (it != members.end() && std::string_view(it->first) < keys[i]) {
+            ++it;
+        }
+        out[i] = it != members.end() && it->first == keys[i] ? &it->second
+                                                              : nullptr;
+    }
+}
+
+JsonKey::JsonKey(std::string_view name)
+    : _name(name), _hash(key_hash(name)) {
+}
+
+const std::string &JsonKey::name() const {
+    return _name;
+}
+
+std::size_t JsonKey::hash() const {
+    return _hash;
+}
+
+std::string Json::stringify(bool asciiOnly) const {
+    std::string ret;
+    Json::pstringify(ret, 0, false, asciiOnly);
+    return ret;
+}
+
+std::string Json::fmtStringify(bool asciiOnly) const {
+    std::string ret;
+    Json::pstringify(ret, 0, true, asciiOnly);
+    return ret;
+}
+
+void Json::pstringify(
+    std::string &ret, std::size_t spaceNum, bool isFmt, bool asciiOnly) const {
+    if (!isFmt && !asciiOnly && _cache && (isArray() || isObject())) {
+        if (_cache->valid) {
+            ret += _cache->text;
+            return;
+        }
+        // Detach the cache so the recursive call encodes instead of reading
+        // it, keep the text and splice it in.
+        _cache->text.clear();
+        std::unique_ptr<Cache> cache = std::move(_cache);
+        adopt(cache.get());
+        pstringify(cache->text, spaceNum, isFmt);
+        cache->valid = true;
+        ret += cache->text;
+        _cache = std::move(cache);
+        return;
+    }
     switch (_type) {
         case Type::JSON_NULL:
             ret += "null";
@@ -377,22 +906,29 @@ std::string Json::pstringify(std::size_t spaceNum, bool isFmt) const {
             ret += std::to_string(std::get<double>(_value));
             break;
         case Type::JSON_STRING:
-            if (isFmt) { ret += "\""; }
-            ret += std::string_view{*std::get<str_ptr>(_value)};
-            if (isFmt) { ret += "\""; }
+            appendQuoted(ret, *std::get<str_ptr>(_value), asciiOnly);
             break;
         case Type::JSON_ARRAY: {
             ret += "[";
             if (isFmt) { ret += "\n"; }
-            size_t i = 0;
-            for (const auto &value : *std::get<arr_ptr>(_value)) {
+            const std::size_t n = size().value();
+            const auto *ints = getIntArray();
+            const auto *doubles = getDoubleArray();
+            for (std::size_t i = 0; i < n; i++) {
                 if (i != 0) {
                     ret += ',';
                     if (isFmt) { ret += '\n'; }
                 }
-                i++;
                 if (isFmt) { ret += std::string(spaceNum + 2, ' '); }
-                ret += value.pstringify(spaceNum + 2, isFmt);
+                // Numbers are written as their Json elements would be.
+                if (ints) {
+                    ret += std::to_string((*ints)[i]);
+                } else if (doubles) {
+                    ret += std::to_string((*doubles)[i]);
+                } else {
+                    (*std::get<arr_ptr>(_value))[i].pstringify(
+                        ret, spaceNum + 2, isFmt, asciiOnly);
+                }
             }
             if (isFmt) { ret += "\n"; }
             if (isFmt) { ret += std::string(spaceNum, ' '); }
@@ -403,19 +939,18 @@ std::string Json::pstringify(std::size_t spaceNum, bool isFmt) const {
             ret += "{";
             if (isFmt) { ret += "\n"; }
             size_t i = 0;
-            for (const auto [k, v] : *std::get<obj_ptr>(_value)) {
+            for (const auto &[k, v] : *std::get<obj_ptr>(_value)) {
                 if (i != 0) {
                     ret += ',';
                     if (isFmt) { ret += '\n'; }
                 }
                 if (isFmt) { ret += std::string(spaceNum + 2, ' '); }
-                ret += "\"";
-                ret += k;
-                ret += "\"";
+                appendQuoted(ret, k, asciiOnly);
                 if (isFmt) { ret += " "; }
                 ret += ":";
                 if (isFmt) { ret += " "; }
-                ret += v.pstringify(spaceNum + 7 + k.size(), isFmt);
+                v.pstringify(
+                    ret, spaceNum + 7 + k.size(), isFmt, asciiOnly);
                 i++;
             }
             if (isFmt) { ret += '\n'; }
@@ -424,5 +959,4 @@ std::string Json::pstringify(std::size_t spaceNum, bool isFmt) const {
             break;
         }
     }
-    return ret;
 }
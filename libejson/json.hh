@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <string>
@@ -8,6 +9,7 @@
 #include <optional>
 #include <memory>
 #include <any>
+#include <string_view>
 
 namespace eee {
 
@@ -22,9 +24,43 @@ enum class Type {
     JSON_OBJECT
 };
 
+//! \brief An object key with its hash computed once, for looking the same
+//! member up in many objects with Json::find(const JsonKey &).
+class JsonKey {
+  private:
+    std::string _name;
+    std::size_t _hash;
+
+  public:
+    explicit JsonKey(std::string_view name);
+
+    const std::string &name() const;
+    std::size_t hash() const;
+};
+
 //! \brief The container part of a JSON Lib implementation.
 class Json {
   private:
+    //! Elements of an array with numeric storage.
+    template <typename T>
+    struct Numbers {
+        std::vector<T> values;
+        //! Json copies of values for const operator[], built at the first
+        //! such access and dropped by every change. It is published
+        //! atomically, so readers sharing a document may race to build it.
+        mutable std::atomic<std::vector<Json> *> view{nullptr};
+
+        explicit Numbers(std::vector<T> items) : values(std::move(items)) {}
+        ~Numbers() { delete view.load(); }
+
+        //! \brief The view, built if needed.
+        const std::vector<Json> &json() const;
+        //! \brief Drop the view, called after values change.
+        void changed() { delete view.exchange(nullptr); }
+    };
+    using ints_ptr = std::unique_ptr<Numbers<int>>;
+    using doubles_ptr = std::unique_ptr<Numbers<double>>;
+
     //! Data structure for save the JSON data.
     std::variant<
         std::nullptr_t,
@@ -33,18 +69,70 @@ class Json {
         double,
         std::unique_ptr<std::string>,
         std::unique_ptr<std::vector<Json>>,
-        std::unique_ptr<std::map<std::string, Json>>>
+        std::unique_ptr<std::map<std::string, Json>>,
+        ints_ptr,
+        doubles_ptr>
         _value;
     //! Type of JSON.
     Type _type;
 
+    //! Serialization and hash cache of an array or object, see
+    //! enableCache(). Other values only use it to reach their parent.
+    struct Cache {
+        //! Cache of the array or object holding this value, set when that
+        //! cache is filled
+        Cache *parent = nullptr;
+        //! stringify() output of the subtree
+        std::string text;
+        //! 'false' once the subtree may have changed
+        bool valid = false;
+        //! hash() of the subtree
+        std::size_t hash = 0;
+        //! 'false' once the subtree may have changed
+        bool hashValid = false;
+        //! One member in index
+        struct Slot {
+            std::size_t hash = 0;
+            const std::string *name = nullptr;
+            const Json *value = nullptr;
+        };
+        //! Open addressing table over the members of a large object for
+        //! find(const JsonKey &), empty until first needed
+        std::vector<Slot> index;
+        //! 'false' once the members may have changed
+        bool indexValid = false;
+
+        //! \brief Drop the text and hash of this cache and of every cache
+        //! above it.
+        void invalidate();
+    };
+    //! nullptr unless caching is enabled for this value.
+    mutable std::unique_ptr<Cache> _cache;
+
+    //! \brief Drop the cached text and hash of this value and of the values
+    //! holding it, called by every mutation.
+    void touch() const;
+    //! \brief Point the elements or members at cache, giving them caches of
+    //! their own if needed, so that mutating them through a reference kept
+    //! from before reaches cache. Called before cache is filled, so that
+    //! the arrays and objects among them fill theirs too.
+    void adopt(Cache *cache) const;
+
     //! \brief Convert JSON data structures to strings. This function will be
-    //! called by stringify() and fmtStringify(). \param isFmt 'true' if
-    //! formatting is required.
-    std::string pstringify(std::size_t spaceNum = 0, bool isFmt = false) const;
+    //! called by stringify() and fmtStringify(). \param out Output appended
+    //! to. \param isFmt 'true' if formatting is required. \param asciiOnly
+    //! 'true' to escape non-ASCII characters.
+    void pstringify(
+        std::string &out,
+        std::size_t spaceNum = 0,
+        bool isFmt = false,
+        bool asciiOnly = false) const;
 
     //! \brief Deep copy a Json
     void copy(const Json &json);
+    //! \brief The elements of an array, converting numeric storage to
+    //! generic storage first.
+    std::vector<Json> &elements();
 
   public:
     explicit Json();
@@ -62,10 +150,22 @@ class Json {
     explicit Json(const char *value);
     //! \brief Construct a Json from string.
     explicit Json(const std::string &value);
+    //! \brief Construct a Json from string, taking its contents.
+    explicit Json(std::string &&value);
     //! \brief Construct a Json from array.
     explicit Json(const std::vector<Json> &value);
     //! \brief Construct a Json from object.
     explicit Json(const std::map<std::string, Json> &value);
+    //! \brief Construct a Json from array, taking its elements.
+    explicit Json(std::vector<Json> &&value);
+    //! \brief Construct a Json from object, taking its members.
+    explicit Json(std::map<std::string, Json> &&value);
+    //! \brief Construct an array of int stored contiguously, see
+    //! getIntArray().
+    explicit Json(std::vector<int> &&value);
+    //! \brief Construct an array of double stored contiguously, see
+    //! getDoubleArray().
+    explicit Json(std::vector<double> &&value);
 
     Json(const Json &other);
     Json(Json &&other) noexcept;
@@ -85,9 +185,15 @@ class Json {
     Json &operator=(const std::vector<Json> &value);
     Json &operator=(const std::map<std::string, Json> &value);
 
-    //! \brief Compare two Jsons
+    //! \brief Compare two Jsons. Subtrees whose cached hashes differ are
+    //! rejected without being walked.
     //! \return 'true' if both JSON have equal _value and _type.
     bool equal(const Json &other) const;
+    //! \brief Structural hash, stable across runs and processes. Equal Jsons
+    //! have equal hashes; members of an object are combined independently of
+    //! their order. With enableCache() the hash of each array and object is
+    //! kept until the subtree is mutated.
+    std::size_t hash() const;
     //! \brief Compare two Jsons
     //! \return 'true' if both JSON have equal _value and _type.
     bool operator==(const Json &other) const;
@@ -139,6 +245,28 @@ class Json {
     //! \return 'nullopt' if the type of Json is not Type::JSON_OBJECT
     std::optional<std::map<std::string, Json>> valueObject() const;
 
+    //! \brief Get the String without copying it
+    //! \return 'nullptr' if the type of Json is not Type::JSON_STRING
+    const std::string *getString() const;
+    //! \brief Get the Array without copying it
+    //! \return 'nullptr' if the type of Json is not Type::JSON_ARRAY or the
+    //! array has numeric storage
+    const std::vector<Json> *getArray() const;
+    //! \brief Get the elements of an array stored as contiguous ints, which
+    //! Parser::setNumericArrays() produces for arrays of only ints. Such an
+    //! array behaves like any other: push_back() of an int keeps the
+    //! storage, other values and mutable element access convert it to
+    //! generic storage.
+    //! \return 'nullptr' if the Json is not an array with int storage
+    const std::vector<int> *getIntArray() const;
+    //! \brief Get the elements of an array stored as contiguous doubles, see
+    //! getIntArray().
+    //! \return 'nullptr' if the Json is not an array with double storage
+    const std::vector<double> *getDoubleArray() const;
+    //! \brief Get the Object without copying it
+    //! \return 'nullptr' if the type of Json is not Type::JSON_OBJECT
+    const std::map<std::string, Json> *getObject() const;
+
     //! \brief Get length of String
     //! \return 'nullopt' if the type of Json is not Type::JSON_STRING
     std::optional<std::size_t> length() const;
@@ -148,11 +276,19 @@ class Json {
     std::optional<std::size_t> size() const;
 
     //! \brief Consistent with vector's [].
-    Json &operator[](std::size_t index) const;
+    Json &operator[](std::size_t index);
     //! \brief Consistent with map's [].
-    Json &operator[](const char *key) const;
+    Json &operator[](const char *key);
     //! \brief Consistent with map's [].
-    Json &operator[](const std::string &key) const;
+    Json &operator[](const std::string &key);
+    //! \brief Consistent with vector's at(), throws std::out_of_range.
+    //! Elements of arrays with numeric storage are Json copies kept with
+    //! the array until it changes.
+    const Json &operator[](std::size_t index) const;
+    //! \brief Consistent with map's at(), throws std::out_of_range.
+    const Json &operator[](const char *key) const;
+    //! \brief Consistent with map's at(), throws std::out_of_range.
+    const Json &operator[](const std::string &key) const;
 
     //! \brief Consistent with vector's push_back().
     void push_back(const Json &other);
@@ -160,6 +296,8 @@ class Json {
     void insert(std::pair<const char *, Json> k_v);
     //! \brief Consistent with map's insert.
     void insert(std::pair<const std::string &, Json> k_v);
+    //! \brief Consistent with vector's insert, index may be size().
+    void insert(std::size_t index, Json value);
 
     //! \brief Consistent with vector's erase.
     void erase(std::size_t index);
@@ -171,18 +309,86 @@ class Json {
     //! \brief Consistent with empty of vector or map.
     bool empty() const;
     //! \brief Consistent with find of map.
-    std::map<std::string, Json>::iterator find(const char *key) const; // object
+    std::map<std::string, Json>::iterator find(const char *key); // object
     //! \brief Consistent with find of map.
     std::map<std::string, Json>::iterator
+    find(const std::string &key); // object
+    //! \brief Consistent with find of map.
+    std::map<std::string, Json>::const_iterator
+    find(const char *key) const; // object
+    //! \brief Consistent with find of map.
+    std::map<std::string, Json>::const_iterator
     find(const std::string &key) const; // object
+    //! \brief Consistent with find of map, without building a std::string:
+    //! the key is compared through a per-thread buffer that keeps its
+    //! capacity.
+    std::map<std::string, Json>::iterator find(std::string_view key);
+    //! \brief Consistent with find of map, without building a std::string.
+    std::map<std::string, Json>::const_iterator
+    find(std::string_view key) const;
+    //! \brief Member key of an object, looked up without allocating.
+    //! \return 'nullptr' if the Json is not an object or has no such member
+    const Json *get(std::string_view key) const;
+    //! \brief Member key.name() of an object. With enableCache(), objects of
+    //! at least kIndexedSize members keep a hash table of their members,
+    //! built at the first such lookup and dropped by mutations, so the hash
+    //! in key makes repeated lookups close to one string compare. Like the
+    //! other caches it is filled by const calls, so do not call this from
+    //! several threads on the same cached document.
+    //! \return 'nullptr' if the Json is not an object or has no such member
+    const Json *find(const JsonKey &key) const;
+    //! \brief Look up count keys of an object at once, storing in out[i]
+    //! the member keys[i] or nullptr. The keys are sorted and matched
+    //! against the members in one ordered walk, or looked up one by one
+    //! when they are few compared to the members.
+    void findAll(
+        const std::string_view *keys,
+        std::size_t count,
+        const Json **out) const;
+
+    //! \brief Objects this large get a hash index for find(const JsonKey &)
+    static constexpr std::size_t kIndexedSize = 16;
+
+    //! \brief Remember the stringify() output and hash() of this value and of
+    //! every array and object below it. Every value below a filled cache
+    //! links to the cache of the value holding it, and a mutation (assignment,
+    //! operator[], find, push_back, insert, erase) drops the cached text and
+    //! hash of the mutated value and of every value above it. So after
+    //! `doc["a"]["b"] = x`, also when done through a reference to doc["a"]
+    //! kept from before, the next stringify() re-encodes only doc, doc["a"]
+    //! and doc["a"]["b"] and copies the cached text of everything else.
+    //! The links cost one small allocation for every value in the document.
+    //!
+    //! Const calls (stringify(), hash(), ==, find(const JsonKey &)) fill the
+    //! caches, so a cached value must not be used from several threads at
+    //! once, not even only for reading. SharedDocument drops the caches of
+    //! the documents it publishes for this reason.
+    void enableCache();
+    //! \brief Drop the caches of this value and every value below it. The
+    //! values holding it are invalidated, and if they are still cached their
+    //! next stringify() or hash() links this value to them again.
+    void disableCache();
 
     //! \brief Convert JSON to string
-    std::string stringify() const;
+    //! \param asciiOnly 'true' to write non-ASCII characters as \u escapes
+    std::string stringify(bool asciiOnly = false) const;
     //! \brief Convert JSON to string
-    std::string fmtStringify() const;
-    friend std::ostream &operator<<(std::ostream &a, Json &b) {
+    //! \param asciiOnly 'true' to write non-ASCII characters as \u escapes
+    std::string fmtStringify(bool asciiOnly = false) const;
+    friend std::ostream &operator<<(std::ostream &a, const Json &b) {
         return a << b.stringify();
     }
 };
 
 } // namespace eee
+
+namespace std {
+
+template <>
+struct hash<eee::Json> {
+    std::size_t operator()(const eee::Json &json) const {
+        return json.hash();
+    }
+};
+
+} // namespace std
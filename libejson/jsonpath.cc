@@ -0,0 +1,575 @@
+#include "jsonpath.hh"
+#include "tokenizer.hh"
+#include <stdexcept>
+#include <utility>
+
+using namespace eee;
+
+struct JsonPath::Cursor {
+    std::string_view text;
+    std::size_t pos;
+
+    [[noreturn]] void fail(const char *what) const {
+        throw std::logic_error(
+            std::string(what) + " (offset " + std::to_string(pos) + ")");
+    }
+    void skipWhitespace() {
+        while (pos < text.size()
+               && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n'
+                   || text[pos] == '\r')) {
+            pos++;
+        }
+    }
+    //! '\0' at the end
+    char at(std::size_t i) const {
+        return i < text.size() ? text[i] : '\0';
+    }
+    bool consume(std::string_view token) {
+        skipWhitespace();
+        if (text.compare(pos, token.size(), token) != 0) { return false; }
+        pos += token.size();
+        return true;
+    }
+    void expect(char c) {
+        if (!consume(std::string_view(&c, 1))) { fail("path failed !"); }
+    }
+};
+
+namespace {
+
+bool is_name(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+           || (c >= '0' && c <= '9') || c == '_' || c == '-'
+           || static_cast<unsigned char>(c) >= 0x80;
+}
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool as_number(const Json &json, double &out) {
+    if (json.isInt()) {
+        out = json.valueInt().value();
+        return true;
+    }
+    if (json.isDouble()) {
+        out = json.valueDouble().value();
+        return true;
+    }
+    return false;
+}
+
+bool equal_values(const Json &a, const Json &b) {
+    double x = 0, y = 0;
+    if (as_number(a, x) && as_number(b, y)) { return x == y; }
+    return a == b;
+}
+
+bool less_values(const Json &a, const Json &b) {
+    double x = 0, y = 0;
+    if (as_number(a, x) && as_number(b, y)) { return x < y; }
+    if (a.isString() && b.isString()) {
+        return *a.getString() < *b.getString();
+    }
+    return false;
+}
+
+} // namespace
+
+JsonPath::JsonPath(std::string_view expression)
+    : _expression(expression), _steps(), _exprs() {
+    Cursor cur{_expression, 0};
+    if (!cur.consume("$")) { cur.fail("path must start with $ !"); }
+    parse_segments(cur, _steps);
+    cur.skipWhitespace();
+    if (cur.pos != cur.text.size()) { cur.fail("path failed !"); }
+}
+
+const std::string &JsonPath::expression() const {
+    return _expression;
+}
+
+void JsonPath::parse_segments(Cursor &cur, std::vector<Step> &steps) {
+    for (;;) {
+        Step step;
+        if (cur.at(cur.pos) == '.' && cur.at(cur.pos + 1) == '.') {
+            step.recursive = true;
+            cur.pos += 2;
+            if (cur.at(cur.pos) == '[') {
+                cur.pos++;
+                parse_bracket(cur, step);
+                steps.push_back(std::move(step));
+                continue;
+            }
+        } else if (cur.at(cur.pos) == '.') {
+            cur.pos++;
+        } else if (cur.at(cur.pos) == '[') {
+            cur.pos++;
+            parse_bracket(cur, step);
+            steps.push_back(std::move(step));
+            continue;
+        } else {
+            return;
+        }
+        // A dotted member name or wildcard.
+        if (cur.at(cur.pos) == '*') {
+            step.kind = Step::Kind::WILDCARD;
+            cur.pos++;
+        } else {
+            const std::size_t begin = cur.pos;
+            while (is_name(cur.at(cur.pos))) { cur.pos++; }
+            if (cur.pos == begin) { cur.fail("name failed !"); }
+            step.name.assign(cur.text.substr(begin, cur.pos - begin));
+        }
+        steps.push_back(std::move(step));
+    }
+}
+
+void JsonPath::parse_bracket(Cursor &cur, Step &step) {
+    auto read_int = [&cur](std::int64_t &out) {
+        cur.skipWhitespace();
+        const std::size_t begin = cur.pos;
+        if (cur.at(cur.pos) == '-') { cur.pos++; }
+        if (!is_digit(cur.at(cur.pos))) {
+            cur.pos = begin;
+            return false;
+        }
+        while (is_digit(cur.at(cur.pos))) { cur.pos++; }
+        out = Tokenizer::toInt(cur.text.substr(begin, cur.pos - begin));
+        return true;
+    };
+
+    cur.skipWhitespace();
+    const char c = cur.at(cur.pos);
+    if (c == '*') {
+        step.kind = Step::Kind::WILDCARD;
+        cur.pos++;
+    } else if (c == '\'' || c == '"') {
+        step.kind = Step::Kind::NAME;
+        std::size_t e = parse_operand(cur);
+        if (!_exprs[e].literal.isString()) { cur.fail("name failed !"); }
+        step.name = *_exprs[e].literal.getString();
+        _exprs.pop_back();
+    } else if (c == '?') {
+        step.kind = Step::Kind::FILTER;
+        cur.pos++;
+        step.filter = parse_or(cur);
+    } else {
+        const bool first = read_int(step.start);
+        if (cur.consume(":")) {
+            step.kind = Step::Kind::SLICE;
+            step.hasStart = first;
+            step.hasEnd = read_int(step.end);
+            if (cur.consume(":")) {
+                std::int64_t stride = 1;
+                if (read_int(stride)) { step.stride = stride; }
+            }
+        } else if (first) {
+            step.kind = Step::Kind::INDEX;
+        } else {
+            cur.fail("bracket failed !");
+        }
+    }
+    cur.expect(']');
+}
+
+std::size_t JsonPath::parse_or(Cursor &cur) {
+    std::size_t lhs = parse_and(cur);
+    while (cur.consume("||")) {
+        Expr e;
+        e.op = Expr::Op::OR;
+        e.lhs = lhs;
+        e.rhs = parse_and(cur);
+        _exprs.push_back(std::move(e));
+        lhs = _exprs.size() - 1;
+    }
+    return lhs;
+}
+
+std::size_t JsonPath::parse_and(Cursor &cur) {
+    std::size_t lhs = parse_unary(cur);
+    while (cur.consume("&&")) {
+        Expr e;
+        e.op = Expr::Op::AND;
+        e.lhs = lhs;
+        e.rhs = parse_unary(cur);
+        _exprs.push_back(std::move(e));
+        lhs = _exprs.size() - 1;
+    }
+    return lhs;
+}
+
+std::size_t JsonPath::parse_unary(Cursor &cur) {
+    // '!' but not the start of '!='.
+    cur.skipWhitespace();
+    if (cur.at(cur.pos) == '!' && cur.at(cur.pos + 1) != '=') {
+        cur.pos++;
+        Expr e;
+        e.op = Expr::Op::NOT;
+        e.lhs = parse_unary(cur);
+        _exprs.push_back(std::move(e));
+        return _exprs.size() - 1;
+    }
+    return parse_comparison(cur);
+}
+
+std::size_t JsonPath::parse_comparison(Cursor &cur) {
+    static const std::pair<const char *, Expr::Op> ops[] = {
+        {"==", Expr::Op::EQ},
+        {"!=", Expr::Op::NE},
+        {"<=", Expr::Op::LE},
+        {">=", Expr::Op::GE},
+        {"<", Expr::Op::LT},
+        {">", Expr::Op::GT}};
+    std::size_t lhs = parse_operand(cur);
+    for (const auto &[token, op] : ops) {
+        if (cur.consume(token)) {
+            Expr e;
+            e.op = op;
+            e.lhs = lhs;
+            e.rhs = parse_operand(cur);
+            _exprs.push_back(std::move(e));
+            return _exprs.size() - 1;
+        }
+    }
+    return lhs;
+}
+
+std::size_t JsonPath::parse_operand(Cursor &cur) {
+    cur.skipWhitespace();
+    const char c = cur.at(cur.pos);
+    Expr e;
+    if (c == '(') {
+        cur.pos++;
+        std::size_t inner = parse_or(cur);
+        cur.expect(')');
+        return inner;
+    }
+    if (c == '@') {
+        cur.pos++;
+        e.op = Expr::Op::PATH;
+        parse_segments(cur, e.path);
+    } else if (c == '\'' || c == '"') {
+        // Quoted string, with backslash escaping the next character.
+        std::string value;
+        for (cur.pos++; cur.at(cur.pos) != c; cur.pos++) {
+            if (cur.pos >= cur.text.size()) { cur.fail("string end failed !"); }
+            if (cur.text[cur.pos] == '\\') { cur.pos++; }
+            value.push_back(cur.at(cur.pos));
+        }
+        cur.pos++;
+        e.literal = Json(std::move(value));
+    } else if (cur.consume("true")) {
+        e.literal = Json(true);
+    } else if (cur.consume("false")) {
+        e.literal = Json(false);
+    } else if (cur.consume("null")) {
+        e.literal = Json();
+    } else if (c == '-' || is_digit(c)) {
+        const std::size_t begin = cur.pos++;
+        for (char d = cur.at(cur.pos); is_digit(d) || d == '.' || d == 'e'
+                                       || d == 'E' || d == '+' || d == '-';
+             d = cur.at(++cur.pos)) {}
+        Tokenizer tokens(cur.text.substr(begin, cur.pos - begin));
+        e.literal = tokens.readValue();
+        if (!tokens.done()) { cur.fail("number failed !"); }
+    } else {
+        cur.fail("operand failed !");
+    }
+    _exprs.push_back(std::move(e));
+    return _exprs.size() - 1;
+}
+
+namespace {
+
+//! Indices of an array of len elements picked by an INDEX or SLICE step,
+//! following RFC 9535.
+template <typename Step>
+void pick(const Step &step, std::size_t len, std::vector<std::size_t> &out) {
+    const std::int64_t n = static_cast<std::int64_t>(len);
+    auto normalize = [n](std::int64_t i) { return i >= 0 ? i : n + i; };
+    if (step.kind == Step::Kind::INDEX) {
+        std::int64_t i = normalize(step.start);
+        if (i >= 0 && i < n) { out.push_back(static_cast<std::size_t>(i)); }
+        return;
+    }
+    const std::int64_t stride = step.stride;
+    if (stride == 0) { return; }
+    auto clamp = [](std::int64_t v, std::int64_t lo, std::int64_t hi) {
+        return v < lo ? lo : (v > hi ? hi : v);
+    };
+    if (stride > 0) {
+        std::int64_t lower =
+            step.hasStart ? clamp(normalize(step.start), 0, n) : 0;
+        std::int64_t upper = step.hasEnd ? clamp(normalize(step.end), 0, n) : n;
+        for (std::int64_t i = lower; i < upper; i += stride) {
+            out.push_back(static_cast<std::size_t>(i));
+        }
+    } else {
+        std::int64_t upper =
+            step.hasStart ? clamp(normalize(step.start), -1, n - 1) : n - 1;
+        std::int64_t lower =
+            step.hasEnd ? clamp(normalize(step.end), -1, n - 1) : -1;
+        for (std::int64_t i = upper; i > lower; i += stride) {
+            out.push_back(static_cast<std::size_t>(i));
+        }
+    }
+}
+
+//! Call f on every element or member value of json. Elements are reached
+//! through operator[], which also covers arrays with numeric storage.
+template <typename F>
+void for_children(const Json &json, F &&f) {
+    if (json.isArray()) {
+        const std::size_t n = json.size().value();
+        for (std::size_t i = 0; i < n; i++) { f(json[i]); }
+    } else if (const auto *object = json.getObject()) {
+        for (const auto &member : *object) { f(member.second); }
+    }
+}
+
+} // namespace
+
+void JsonPath::walk(
+    const Json &node,
+    const std::vector<Step> &steps,
+    std::size_t step,
+    std::vector<const Json *> &out) const {
+    if (step == steps.size()) {
+        out.push_back(&node);
+        return;
+    }
+    const Step &s = steps[step];
+    switch (s.kind) {
+        case Step::Kind::NAME:
+            if (const auto *object = node.getObject()) {
+                auto it = object->find(s.name);
+                if (it != object->end()) {
+                    walk(it->second, steps, step + 1, out);
+                }
+            }
+            break;
+        case Step::Kind::WILDCARD:
+            for_children(node, [&](const Json &child) {
+                walk(child, steps, step + 1, out);
+            });
+            break;
+        case Step::Kind::INDEX:
+        case Step::Kind::SLICE:
+            if (node.isArray()) {
+                std::vector<std::size_t> indices;
+                pick(s, node.size().value(), indices);
+                for (std::size_t i : indices) {
+                    walk(node[i], steps, step + 1, out);
+                }
+            }
+            break;
+        case Step::Kind::FILTER:
+            for_children(node, [&](const Json &child) {
+                if (test(s.filter, child)) {
+                    walk(child, steps, step + 1, out);
+                }
+            });
+            break;
+    }
+    if (s.recursive) {
+        for_children(node, [&](const Json &child) {
+            walk(child, steps, step, out);
+        });
+    }
+}
+
+std::size_t JsonPath::walk_text(
+    std::string_view text,
+    std::size_t offset,
+    const std::vector<Step> &steps,
+    std::size_t step,
+    std::vector<Json> &out,
+    bool decode) const {
+    Tokenizer tokens(text);
+    tokens.seek(offset);
+    if (step == steps.size()) {
+        if (decode) {
+            out.push_back(tokens.readValue());
+        } else {
+            tokens.skipValue();
+            out.emplace_back();
+        }
+        return tokens.position();
+    }
+    const Step &s = steps[step];
+    const char open = tokens.peek();
+    if (open != '[' && open != '{') {
+        tokens.skipValue();
+        return tokens.position();
+    }
+
+    const bool object = open == '{';
+    const char close = object ? '}' : ']';
+    const bool indexed =
+        s.kind == Step::Kind::INDEX || s.kind == Step::Kind::SLICE;
+    const std::size_t begin = tokens.position();
+    // Offsets of the elements, needed when indices count from the end.
+    std::vector<std::size_t> elements;
+    tokens.consume(open);
+    if (!tokens.consume(close)) {
+        do {
+            bool match = s.kind == Step::Kind::WILDCARD;
+            if (object) {
+                std::string_view key = tokens.readString();
+                tokens.expect(':');
+                match = match || (s.kind == Step::Kind::NAME && key == s.name);
+            }
+            tokens.skipWhitespace();
+            const std::size_t child = tokens.position();
+            if (s.kind == Step::Kind::FILTER) {
+                match = test_text(s.filter, text, child);
+            }
+            if (match) {
+                tokens.seek(
+                    walk_text(text, child, steps, step + 1, out, decode));
+                continue;
+            }
+            if (indexed && !object) { elements.push_back(child); }
+            tokens.skipValue();
+        } while (tokens.consume(','));
+        tokens.expect(close);
+    }
+    const std::size_t end = tokens.position();
+
+    if (indexed && !object) {
+        std::vector<std::size_t> indices;
+        pick(s, elements.size(), indices);
+        for (std::size_t i : indices) {
+            walk_text(text, elements[i], steps, step + 1, out, decode);
+        }
+    }
+    if (s.recursive) {
+        tokens.seek(begin);
+        tokens.consume(open);
+        if (!tokens.consume(close)) {
+            do {
+                if (object) {
+                    tokens.readString();
+                    tokens.expect(':');
+                }
+                const char c = tokens.peek();
+                if (c == '[' || c == '{') {
+                    tokens.seek(walk_text(
+                        text, tokens.position(), steps, step, out, decode));
+                } else {
+                    tokens.skipValue();
+                }
+            } while (tokens.consume(','));
+        }
+    }
+    return end;
+}
+
+bool JsonPath::test(std::size_t expr, const Json &node) const {
+    const Expr &e = _exprs[expr];
+    switch (e.op) {
+        case Expr::Op::OR:
+            return test(e.lhs, node) || test(e.rhs, node);
+        case Expr::Op::AND:
+            return test(e.lhs, node) && test(e.rhs, node);
+        case Expr::Op::NOT:
+            return !test(e.lhs, node);
+        case Expr::Op::PATH:
+            return operand(expr, node) != nullptr;
+        case Expr::Op::LITERAL:
+            return !e.literal.isNull() && e.literal != Json(false);
+        default:
+            break;
+    }
+    return compare(e.op, operand(e.lhs, node), operand(e.rhs, node));
+}
+
+bool JsonPath::test_text(
+    std::size_t expr, std::string_view text, std::size_t offset) const {
+    const Expr &e = _exprs[expr];
+    switch (e.op) {
+        case Expr::Op::OR:
+            return test_text(e.lhs, text, offset)
+                   || test_text(e.rhs, text, offset);
+        case Expr::Op::AND:
+            return test_text(e.lhs, text, offset)
+                   && test_text(e.rhs, text, offset);
+        case Expr::Op::NOT:
+            return !test_text(e.lhs, text, offset);
+        case Expr::Op::PATH: {
+            // Existence only, nothing is decoded.
+            std::vector<Json> found;
+            walk_text(text, offset, e.path, 0, found, false);
+            return !found.empty();
+        }
+        case Expr::Op::LITERAL:
+            return !e.literal.isNull() && e.literal != Json(false);
+        default:
+            break;
+    }
+    std::vector<Json> lhs, rhs;
+    return compare(
+        e.op,
+        operand_text(e.lhs, text, offset, lhs),
+        operand_text(e.rhs, text, offset, rhs));
+}
+
+bool JsonPath::compare(Expr::Op op, const Json *a, const Json *b) {
+    // A path that selects nothing only equals another one.
+    const bool eq = (a && b) ? equal_values(*a, *b) : (!a && !b);
+    switch (op) {
+        case Expr::Op::EQ:
+            return eq;
+        case Expr::Op::NE:
+            return !eq;
+        case Expr::Op::LT:
+            return a && b && less_values(*a, *b);
+        case Expr::Op::LE:
+            return a && b && (eq || less_values(*a, *b));
+        case Expr::Op::GT:
+            return a && b && less_values(*b, *a);
+        case Expr::Op::GE:
+            return a && b && (eq || less_values(*b, *a));
+        default:
+            return false;
+    }
+}
+
+const Json *JsonPath::operand(std::size_t expr, const Json &node) const {
+    const Expr &e = _exprs[expr];
+    if (e.op == Expr::Op::LITERAL) { return &e.literal; }
+    if (e.op != Expr::Op::PATH) { return nullptr; }
+    std::vector<const Json *> found;
+    walk(node, e.path, 0, found);
+    return found.empty() ? nullptr : found.front();
+}
+
+const Json *JsonPath::operand_text(
+    std::size_t expr,
+    std::string_view text,
+    std::size_t offset,
+    std::vector<Json> &found) const {
+    const Expr &e = _exprs[expr];
+    if (e.op == Expr::Op::LITERAL) { return &e.literal; }
+    if (e.op != Expr::Op::PATH) { return nullptr; }
+    walk_text(text, offset, e.path, 0, found);
+    return found.empty() ? nullptr : &found.front();
+}
+
+std::vector<const Json *> JsonPath::select(const Json &root) const {
+    std::vector<const Json *> out;
+    walk(root, _steps, 0, out);
+    return out;
+}
+
+std::vector<Json> JsonPath::selectText(std::string_view text) const {
+    std::vector<Json> out;
+    Tokenizer tokens(text);
+    tokens.skipWhitespace();
+    const std::size_t end =
+        walk_text(text, tokens.position(), _steps, 0, out);
+    tokens.seek(end);
+    if (!tokens.done()) { throw std::logic_error("parse is failed ! "); }
+    return out;
+}
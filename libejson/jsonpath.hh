@@ -0,0 +1,127 @@
+#pragma once
+
+#include "json.hh"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace eee {
+
+//! \brief A compiled JSONPath query.
+//!
+//! The expression is parsed once into a list of steps that select() and
+//! selectText() then run over any number of documents. Supported syntax:
+//! - `$` the root, `@` the current value inside a filter
+//! - `.name`, `['name']`, `["name"]` object members
+//! - `.*`, `[*]` every member or element
+//! - `..` before any of these, which then applies at every depth
+//! - `[n]` elements, negative n counting from the end
+//! - `[start:end:step]` slices, as in RFC 9535
+//! - `[?(expr)]` or `[?expr]` filters with `||`, `&&`, `!`, parentheses,
+//!   `==`, `!=`, `<`, `<=`, `>`, `>=`, `@` paths, numbers, 'strings',
+//!   "strings", true, false and null. A lone path tests for existence.
+//!
+//! Syntax errors throw std::logic_error.
+class JsonPath {
+  private:
+    //! \brief One selector of the query
+    struct Step {
+        enum class Kind { NAME, INDEX, WILDCARD, SLICE, FILTER };
+        Kind kind = Kind::NAME;
+        //! \brief Apply at the value and every value below it
+        bool recursive = false;
+        //! \brief Member name of NAME
+        std::string name;
+        //! \brief Index of INDEX, slice bounds and step of SLICE
+        std::int64_t start = 0, end = 0, stride = 1;
+        bool hasStart = false, hasEnd = false;
+        //! \brief Root of the predicate in _exprs for FILTER
+        std::size_t filter = 0;
+    };
+    //! \brief A node of a filter predicate
+    struct Expr {
+        enum class Op { OR, AND, NOT, EQ, NE, LT, LE, GT, GE, PATH, LITERAL };
+        Op op = Op::LITERAL;
+        //! \brief Operands in _exprs
+        std::size_t lhs = 0, rhs = 0;
+        //! \brief Value of LITERAL
+        Json literal;
+        //! \brief Steps of PATH, relative to @
+        std::vector<Step> path;
+    };
+    //! \brief Reading position in the expression being compiled
+    struct Cursor;
+
+    //! \brief The expression as given
+    std::string _expression;
+    //! \brief Steps from the root
+    std::vector<Step> _steps;
+    //! \brief Filter predicates, referenced by index
+    std::vector<Expr> _exprs;
+
+    //! \brief Parse segments until the end of the path
+    void parse_segments(Cursor &cur, std::vector<Step> &steps);
+    //! \brief Parse the inside of [ ] after the '['
+    void parse_bracket(Cursor &cur, Step &step);
+    std::size_t parse_or(Cursor &cur);
+    std::size_t parse_and(Cursor &cur);
+    std::size_t parse_unary(Cursor &cur);
+    std::size_t parse_comparison(Cursor &cur);
+    std::size_t parse_operand(Cursor &cur);
+
+    //! \brief Run steps[step..] from node, appending matches to out
+    void walk(
+        const Json &node,
+        const std::vector<Step> &steps,
+        std::size_t step,
+        std::vector<const Json *> &out) const;
+    //! \brief Run steps[step..] on the value at offset of text
+    //! \param decode 'false' to append a null for each match instead of
+    //! decoding it, when only their number matters
+    //! \return Offset just past that value
+    std::size_t walk_text(
+        std::string_view text,
+        std::size_t offset,
+        const std::vector<Step> &steps,
+        std::size_t step,
+        std::vector<Json> &out,
+        bool decode = true) const;
+    //! \brief Evaluate predicate expr with @ bound to node
+    bool test(std::size_t expr, const Json &node) const;
+    //! \brief Evaluate predicate expr with @ bound to the value at offset of
+    //! text, decoding only the values its paths select
+    bool test_text(
+        std::size_t expr, std::string_view text, std::size_t offset) const;
+    //! \brief Outcome of comparison op on operands a and b, which are
+    //! nullptr for paths that select nothing
+    static bool compare(Expr::Op op, const Json *a, const Json *b);
+    //! \brief Value of an operand, nullptr if a path selects nothing
+    const Json *operand(std::size_t expr, const Json &node) const;
+    //! \brief Value of an operand in text, decoded into found if it is a
+    //! path, nullptr if the path selects nothing
+    const Json *operand_text(
+        std::size_t expr,
+        std::string_view text,
+        std::size_t offset,
+        std::vector<Json> &found) const;
+
+  public:
+    //! \brief Compile expression
+    explicit JsonPath(std::string_view expression);
+
+    //! \brief Values of root matched by the query, in document order except
+    //! that object members come in key order. The pointers are valid while
+    //! root is not modified.
+    std::vector<const Json *> select(const Json &root) const;
+    //! \brief Values matched in JSON text, found with a Tokenizer without
+    //! building the document. Only the matched values are decoded, and of
+    //! the values a filter is tried on only what its paths select. Members
+    //! come in text order.
+    std::vector<Json> selectText(std::string_view text) const;
+    //! \brief The expression the query was compiled from
+    const std::string &expression() const;
+};
+
+} // namespace eee
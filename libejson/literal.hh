@@ -0,0 +1,587 @@
+#pragma once
+
+#include "json.hh"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//! \file
+//! \brief JSON documents parsed at compile time.
+//!
+//! \code
+//! constexpr auto kDefaults = EJSON_LITERAL(R"({"port" : 8080})");
+//! static_assert(kDefaults.root()["port"].valueInt() == 8080);
+//! \endcode
+//! The text is parsed during constant evaluation into fixed-size arrays of
+//! nodes and decoded string bytes, so malformed text (or an object with a
+//! duplicate key) fails the build, and using the document at run time does
+//! no parsing or allocation. Object keys are sorted for binary search.
+//! Doubles are exactly rounded when their significand has at most 15
+//! digits and the decimal exponent is within ±22, and may be one unit in
+//! the last place off beyond. Large documents may need a higher
+//! -fconstexpr-ops-limit.
+
+namespace eee {
+
+namespace literal_detail {
+
+constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+//! \brief One value of a LiteralDocument.
+struct Node {
+    Type type = Type::JSON_NULL;
+    bool boolean = false;
+    int integer = 0;
+    double number = 0;
+    //! \brief String value, in the document's chars
+    std::size_t text = 0, length = 0;
+    //! \brief Member name when the parent is an object, in chars
+    std::size_t key = 0, keyLength = 0;
+    //! \brief Children of an array or object, in the document's links
+    std::size_t first = 0, size = 0;
+    std::size_t parent = npos;
+};
+
+constexpr bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+constexpr bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+constexpr int hex_value(char c) {
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    return -1;
+}
+
+constexpr double power10(int exponent) {
+    double result = 1;
+    for (int i = 0; i < exponent; i++) { result *= 10; }
+    return result;
+}
+
+//! \brief Recursive descent over the text. Without output arrays it only
+//! validates and counts, which sizes the arrays of the second pass.
+class Reader {
+  private:
+    std::string_view _text;
+    std::size_t _pos = 0;
+    Node *_nodes;
+    char *_chars;
+    std::size_t _count = 0, _length = 0;
+
+    constexpr char at(std::size_t i) const {
+        return i < _text.size() ? _text[i] : '\0';
+    }
+    constexpr void skip() {
+        while (is_space(at(_pos))) { _pos++; }
+    }
+    constexpr void put(char c) {
+        if (_chars != nullptr) { _chars[_length] = c; }
+        _length++;
+    }
+    constexpr void put_utf8(std::uint32_t cp) {
+        if (cp < 0x80) {
+            put(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            put(static_cast<char>(0xc0 | (cp >> 6)));
+            put(static_cast<char>(0x80 | (cp & 0x3f)));
+        } else if (cp < 0x10000) {
+            put(static_cast<char>(0xe0 | (cp >> 12)));
+            put(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+            put(static_cast<char>(0x80 | (cp & 0x3f)));
+        } else {
+            put(static_cast<char>(0xf0 | (cp >> 18)));
+            put(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+            put(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+            put(static_cast<char>(0x80 | (cp & 0x3f)));
+        }
+    }
+    constexpr std::uint32_t hex4() {
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            int h = hex_value(at(_pos++));
+            if (h < 0) { throw std::logic_error("string \\u failed !"); }
+            value = (value << 4) | static_cast<std::uint32_t>(h);
+        }
+        return value;
+    }
+    //! \brief Decode the string at _pos into chars
+    //! \return Its offset in chars
+    constexpr std::size_t string() {
+        if (at(_pos) != '"') { throw std::logic_error("string failed !"); }
+        _pos++;
+        const std::size_t begin = _length;
+        for (;;) {
+            if (_pos >= _text.size()) {
+                throw std::logic_error("string end failed !");
+            }
+            const char c = _text[_pos++];
+            if (c == '"') { return begin; }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                throw std::logic_error("string failed !");
+            }
+            if (c != '\\') {
+                put(c);
+                continue;
+            }
+            switch (at(_pos++)) {
+                case '"':
+                    put('"');
+                    break;
+                case '\\':
+                    put('\\');
+                    break;
+                case '/':
+                    put('/');
+                    break;
+                case 'b':
+                    put('\b');
+                    break;
+                case 'f':
+                    put('\f');
+                    break;
+                case 'n':
+                    put('\n');
+                    break;
+                case 'r':
+                    put('\r');
+                    break;
+                case 't':
+                    put('\t');
+                    break;
+                case 'u': {
+                    std::uint32_t cp = hex4();
+                    if (cp >= 0xdc00 && cp <= 0xdfff) {
+                        throw std::logic_error("string \\u failed !");
+                    }
+                    if (cp >= 0xd800 && cp <= 0xdbff) {
+                        if (at(_pos) != '\\' || at(_pos + 1) != 'u') {
+                            throw std::logic_error("string \\u failed !");
+                        }
+                        _pos += 2;
+                        std::uint32_t low = hex4();
+                        if (low < 0xdc00 || low > 0xdfff) {
+                            throw std::logic_error("string \\u failed !");
+                        }
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    put_utf8(cp);
+                    break;
+                }
+                default:
+                    throw std::logic_error("string \\ failed !");
+            }
+        }
+    }
+    constexpr void number(Node *node) {
+        bool negative = false, isDouble = false;
+        std::uint64_t mantissa = 0;
+        int digits = 0, exponent = 0;
+        auto digit = [&](char c, bool fraction) {
+            // Digits beyond 19 only shift the exponent.
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<std::uint64_t>(c - '0');
+                if (mantissa != 0) { digits++; }
+                if (fraction) { exponent--; }
+            } else if (!fraction) {
+                exponent++;
+            }
+        };
+        if (at(_pos) == '-') {
+            negative = true;
+            _pos++;
+        }
+        if (at(_pos) == '0') {
+            _pos++;
+        } else if (is_digit(at(_pos))) {
+            while (is_digit(at(_pos))) { digit(at(_pos++), false); }
+        } else {
+            throw std::logic_error("value is not number !");
+        }
+        if (at(_pos) == '.') {
+            _pos++;
+            isDouble = true;
+            if (!is_digit(at(_pos))) {
+                throw std::logic_error("value is not number !");
+            }
+            while (is_digit(at(_pos))) { digit(at(_pos++), true); }
+        }
+        if (at(_pos) == 'e' || at(_pos) == 'E') {
+            _pos++;
+            isDouble = true;
+            bool minus = false;
+            if (at(_pos) == '+' || at(_pos) == '-') {
+                minus = at(_pos++) == '-';
+            }
+            if (!is_digit(at(_pos))) {
+                throw std::logic_error("value is not number !");
+            }
+            int e = 0;
+            while (is_digit(at(_pos))) {
+                if (e < 100000) { e = e * 10 + (at(_pos) - '0'); }
+                _pos++;
+            }
+            exponent += minus ? -e : e;
+        }
+        // Integers that fit an int stay ints, like Tokenizer::readValue().
+        if (!isDouble && exponent == 0
+            && mantissa <= static_cast<std::uint64_t>(
+                   std::numeric_limits<int>::max()) + (negative ? 1 : 0)) {
+            if (node != nullptr) {
+                node->type = Type::JSON_INT;
+                const auto magnitude = static_cast<std::int64_t>(mantissa);
+                node->integer =
+                    static_cast<int>(negative ? -magnitude : magnitude);
+            }
+            return;
+        }
+        // Exact for mantissas below 2^53 and exponents within ±22.
+        double value = static_cast<double>(mantissa);
+        if (mantissa != 0) {
+            if (exponent < -330) {
+                value = 0;
+            } else if (exponent < 0) {
+                while (exponent < -22) {
+                    value /= 1e22;
+                    exponent += 22;
+                }
+                value /= power10(-exponent);
+            } else {
+                constexpr double max = std::numeric_limits<double>::max();
+                while (exponent > 22) {
+                    if (value > max / 1e22) {
+                        throw std::logic_error("value is not number !");
+                    }
+                    value *= 1e22;
+                    exponent -= 22;
+                }
+                if (value > max / power10(exponent)) {
+                    throw std::logic_error("value is not number !");
+                }
+                value *= power10(exponent);
+            }
+        }
+        if (node != nullptr) {
+            node->type = Type::JSON_DOUBLE;
+            node->number = negative ? -value : value;
+        }
+    }
+    constexpr void word(std::string_view text) {
+        if (_text.substr(_pos, text.size()) != text) {
+            throw std::logic_error("value failed !");
+        }
+        _pos += text.size();
+    }
+    constexpr std::size_t value(std::size_t parent) {
+        skip();
+        const std::size_t index = _count++;
+        Node scratch;
+        Node *node = _nodes != nullptr ? &_nodes[index] : nullptr;
+        if (node != nullptr) { node->parent = parent; }
+        Node &n = node != nullptr ? *node : scratch;
+        switch (at(_pos)) {
+            case 'n':
+                word("null");
+                break;
+            case 't':
+                word("true");
+                n.type = Type::JSON_BOOL;
+                n.boolean = true;
+                break;
+            case 'f':
+                word("false");
+                n.type = Type::JSON_BOOL;
+                break;
+            case '"':
+                n.text = string();
+                n.length = _length - n.text;
+                n.type = Type::JSON_STRING;
+                break;
+            case '[':
+                _pos++;
+                n.type = Type::JSON_ARRAY;
+                skip();
+                if (at(_pos) == ']') {
+                    _pos++;
+                    break;
+                }
+                for (;;) {
+                    value(index);
+                    n.size++;
+                    skip();
+                    if (at(_pos) == ']') { break; }
+                    if (at(_pos) != ',') {
+                        throw std::logic_error("array failed !");
+                    }
+                    _pos++;
+                }
+                _pos++;
+                break;
+            case '{':
+                _pos++;
+                n.type = Type::JSON_OBJECT;
+                skip();
+                if (at(_pos) == '}') {
+                    _pos++;
+                    break;
+                }
+                for (;;) {
+                    skip();
+                    const std::size_t key = string();
+                    const std::size_t keyLength = _length - key;
+                    skip();
+                    if (at(_pos) != ':') {
+                        throw std::logic_error("expected ':' !");
+                    }
+                    _pos++;
+                    const std::size_t child = value(index);
+                    if (_nodes != nullptr) {
+                        _nodes[child].key = key;
+                        _nodes[child].keyLength = keyLength;
+                    }
+                    n.size++;
+                    skip();
+                    if (at(_pos) == '}') { break; }
+                    if (at(_pos) != ',') {
+                        throw std::logic_error("object failed !");
+                    }
+                    _pos++;
+                }
+                _pos++;
+                break;
+            default:
+                number(node);
+                break;
+        }
+        return index;
+    }
+
+  public:
+    constexpr Reader(std::string_view text, Node *nodes, char *chars)
+        : _text(text), _nodes(nodes), _chars(chars) {}
+
+    //! \brief Read the whole text
+    constexpr void parse() {
+        value(npos);
+        skip();
+        if (_pos != _text.size()) {
+            throw std::logic_error("parse is failed ! ");
+        }
+    }
+    //! \brief Number of values read
+    constexpr std::size_t count() const { return _count; }
+};
+
+} // namespace literal_detail
+
+//! \brief Number of values in text, to size a LiteralDocument. Fails the
+//! constant evaluation if text is not JSON.
+constexpr std::size_t literalNodes(std::string_view text) {
+    literal_detail::Reader reader(text, nullptr, nullptr);
+    reader.parse();
+    return reader.count();
+}
+
+//! \brief A read-only view of one value of a LiteralDocument. Cheap to copy;
+//! valid while the document is.
+class LiteralValue {
+  private:
+    const literal_detail::Node *_nodes;
+    const std::size_t *_links;
+    const char *_chars;
+    std::size_t _index;
+
+    constexpr const literal_detail::Node &node() const {
+        return _nodes[_index];
+    }
+    constexpr LiteralValue child(std::size_t i) const {
+        return LiteralValue(_nodes, _links, _chars, _links[node().first + i]);
+    }
+
+  public:
+    constexpr LiteralValue(
+        const literal_detail::Node *nodes,
+        const std::size_t *links,
+        const char *chars,
+        std::size_t index)
+        : _nodes(nodes), _links(links), _chars(chars), _index(index) {}
+
+    constexpr Type type() const { return node().type; }
+    constexpr bool isNull() const { return type() == Type::JSON_NULL; }
+    constexpr bool isBool() const { return type() == Type::JSON_BOOL; }
+    constexpr bool isInt() const { return type() == Type::JSON_INT; }
+    constexpr bool isDouble() const { return type() == Type::JSON_DOUBLE; }
+    constexpr bool isString() const { return type() == Type::JSON_STRING; }
+    constexpr bool isArray() const { return type() == Type::JSON_ARRAY; }
+    constexpr bool isObject() const { return type() == Type::JSON_OBJECT; }
+
+    //! \return 'nullopt' if the value is not a bool
+    constexpr std::optional<bool> valueBool() const {
+        if (!isBool()) { return std::nullopt; }
+        return node().boolean;
+    }
+    //! \return 'nullopt' if the value is not an int
+    constexpr std::optional<int> valueInt() const {
+        if (!isInt()) { return std::nullopt; }
+        return node().integer;
+    }
+    //! \return 'nullopt' if the value is not a double
+    constexpr std::optional<double> valueDouble() const {
+        if (!isDouble()) { return std::nullopt; }
+        return node().number;
+    }
+    //! \return 'nullopt' if the value is not a string
+    constexpr std::optional<std::string_view> valueString() const {
+        if (!isString()) { return std::nullopt; }
+        return std::string_view(_chars + node().text, node().length);
+    }
+    //! \brief Name of the value when it is a member of an object
+    constexpr std::string_view key() const {
+        return std::string_view(_chars + node().key, node().keyLength);
+    }
+    //! \return 'nullopt' if the value is not an array or object
+    constexpr std::optional<std::size_t> size() const {
+        if (!isArray() && !isObject()) { return std::nullopt; }
+        return node().size;
+    }
+
+    //! \brief Element index of an array, or member index of an object in key
+    //! order. Throws std::out_of_range.
+    constexpr LiteralValue operator[](std::size_t index) const {
+        if ((!isArray() && !isObject()) || index >= node().size) {
+            throw std::out_of_range("literal index out of range !");
+        }
+        return child(index);
+    }
+    //! \brief Member of an object, found by binary search. Throws
+    //! std::out_of_range.
+    constexpr LiteralValue operator[](std::string_view key) const {
+        std::optional<LiteralValue> member = find(key);
+        if (!member) { throw std::out_of_range("literal key not found !"); }
+        return *member;
+    }
+    //! \return 'nullopt' if the value is not an object or has no member key
+    constexpr std::optional<LiteralValue> find(std::string_view key) const {
+        if (!isObject()) { return std::nullopt; }
+        std::size_t low = 0, high = node().size;
+        while (low < high) {
+            const std::size_t mid = low + (high - low) / 2;
+            const std::string_view name = child(mid).key();
+            if (name == key) { return child(mid); }
+            if (name < key) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return std::nullopt;
+    }
+
+    //! \brief Copy the value into a Json
+    Json toJson() const {
+        switch (type()) {
+            case Type::JSON_BOOL:
+                return Json(node().boolean);
+            case Type::JSON_INT:
+                return Json(node().integer);
+            case Type::JSON_DOUBLE:
+                return Json(node().number);
+            case Type::JSON_STRING:
+                return Json(std::string(*valueString()));
+            case Type::JSON_ARRAY: {
+                std::vector<Json> items;
+                items.reserve(node().size);
+                for (std::size_t i = 0; i < node().size; i++) {
+                    items.push_back(child(i).toJson());
+                }
+                return Json(std::move(items));
+            }
+            case Type::JSON_OBJECT: {
+                std::map<std::string, Json> members;
+                for (std::size_t i = 0; i < node().size; i++) {
+                    members.emplace(child(i).key(), child(i).toJson());
+                }
+                return Json(std::move(members));
+            }
+            default:
+                return Json();
+        }
+    }
+};
+
+//! \brief A JSON document parsed at compile time, see EJSON_LITERAL.
+//! \tparam Nodes literalNodes() of the text
+//! \tparam Chars Length of the text, enough for its decoded strings
+template <std::size_t Nodes, std::size_t Chars>
+struct LiteralDocument {
+    std::array<literal_detail::Node, Nodes> nodes{};
+    //! \brief Node indices of the children of each array and object
+    std::array<std::size_t, Nodes> links{};
+    std::array<char, Chars + 1> chars{};
+
+    //! \brief The top-level value
+    constexpr LiteralValue root() const {
+        return LiteralValue(nodes.data(), links.data(), chars.data(), 0);
+    }
+};
+
+//! \brief Parse text into a LiteralDocument. Evaluated as a constant
+//! expression, malformed text fails the build.
+template <std::size_t Nodes, std::size_t Chars>
+constexpr LiteralDocument<Nodes, Chars> parseLiteral(std::string_view text) {
+    LiteralDocument<Nodes, Chars> doc;
+    literal_detail::Reader reader(text, doc.nodes.data(), doc.chars.data());
+    reader.parse();
+    // Give each container a range of links, then fill the ranges in
+    // document order, counting size up again.
+    std::size_t next = 0;
+    for (literal_detail::Node &node : doc.nodes) {
+        node.first = next;
+        next += node.size;
+        node.size = 0;
+    }
+    for (std::size_t i = 1; i < Nodes; i++) {
+        literal_detail::Node &parent = doc.nodes[doc.nodes[i].parent];
+        doc.links[parent.first + parent.size++] = i;
+    }
+    // Sort members by key for binary search.
+    auto key = [&](std::size_t i) {
+        return std::string_view(
+            doc.chars.data() + doc.nodes[i].key, doc.nodes[i].keyLength);
+    };
+    for (const literal_detail::Node &node : doc.nodes) {
+        if (node.type != Type::JSON_OBJECT) { continue; }
+        for (std::size_t i = node.first + 1; i < node.first + node.size; i++) {
+            const std::size_t link = doc.links[i];
+            std::size_t j = i;
+            for (; j > node.first && key(doc.links[j - 1]) > key(link); j--) {
+                doc.links[j] = doc.links[j - 1];
+            }
+            doc.links[j] = link;
+            if (j > node.first && key(doc.links[j - 1]) == key(link)) {
+                throw std::logic_error("duplicate key !");
+            }
+        }
+    }
+    return doc;
+}
+
+} // namespace eee
+
+//! \brief Parse the string literal text at compile time into a
+//! LiteralDocument; malformed JSON fails the build. For a string that is
+//! not a literal, use parseLiteral<literalNodes(text), text.size()>(text).
+#define EJSON_LITERAL(text)                                                   \
+    ::eee::parseLiteral<::eee::literalNodes(text), sizeof(text) - 1>(text)
@@ -0,0 +1,300 @@
+#include "msgpack.hh"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace eee;
+
+MsgpackWriter::MsgpackWriter(std::string &out) : _out(out) {
+}
+
+void MsgpackWriter::put(std::uint8_t tag, std::uint64_t value, int bytes) {
+    _out.push_back(static_cast<char>(tag));
+    for (int i = bytes - 1; i >= 0; i--) {
+        _out.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+    }
+}
+
+void MsgpackWriter::writeNull() {
+    _out.push_back(static_cast<char>(0xc0));
+}
+
+void MsgpackWriter::writeBool(bool value) {
+    _out.push_back(static_cast<char>(value ? 0xc3 : 0xc2));
+}
+
+void MsgpackWriter::writeInt(std::int64_t value) {
+    if (value >= 0) {
+        auto u = static_cast<std::uint64_t>(value);
+        if (u < 0x80) {
+            _out.push_back(static_cast<char>(u));
+        } else if (u <= 0xff) {
+            put(0xcc, u, 1);
+        } else if (u <= 0xffff) {
+            put(0xcd, u, 2);
+        } else if (u <= 0xffffffff) {
+            put(0xce, u, 4);
+        } else {
+            put(0xcf, u, 8);
+        }
+        return;
+    }
+    auto u = static_cast<std::uint64_t>(value);
+    if (value >= -32) {
+        _out.push_back(static_cast<char>(u & 0xff));
+    } else if (value >= INT8_MIN) {
+        put(0xd0, u, 1);
+    } else if (value >= INT16_MIN) {
+        put(0xd1, u, 2);
+    } else if (value >= INT32_MIN) {
+        put(0xd2, u, 4);
+    } else {
+        put(0xd3, u, 8);
+    }
+}
+
+void MsgpackWriter::writeDouble(double value) {
+    // Narrowing a finite double outside the float range is undefined.
+    constexpr double kFloatMax = std::numeric_limits<float>::max();
+    const bool inRange = !std::isfinite(value) || std::fabs(value) <= kFloatMax;
+    auto single = inRange ? static_cast<float>(value) : 0.0f;
+    if (inRange && static_cast<double>(single) == value) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &single, sizeof(bits));
+        put(0xca, bits, 4);
+        return;
+    }
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put(0xcb, bits, 8);
+}
+
+void MsgpackWriter::writeString(std::string_view value) {
+    std::size_t size = value.size();
+    if (size < 32) {
+        _out.push_back(static_cast<char>(0xa0 | size));
+    } else if (size <= 0xff) {
+        put(0xd9, size, 1);
+    } else if (size <= 0xffff) {
+        put(0xda, size, 2);
+    } else {
+        put(0xdb, size, 4);
+    }
+    _out.append(value);
+}
+
+void MsgpackWriter::beginArray(std::size_t size) {
+    if (size < 16) {
+        _out.push_back(static_cast<char>(0x90 | size));
+    } else if (size <= 0xffff) {
+        put(0xdc, size, 2);
+    } else {
+        put(0xdd, size, 4);
+    }
+}
+
+void MsgpackWriter::beginMap(std::size_t size) {
+    if (size < 16) {
+        _out.push_back(static_cast<char>(0x80 | size));
+    } else if (size <= 0xffff) {
+        put(0xde, size, 2);
+    } else {
+        put(0xdf, size, 4);
+    }
+}
+
+void MsgpackWriter::write(const Json &json) {
+    switch (json.type()) {
+        case Type::JSON_NULL:
+            writeNull();
+            break;
+        case Type::JSON_BOOL:
+            writeBool(*json.valueBool());
+            break;
+        case Type::JSON_INT:
+            writeInt(*json.valueInt());
+            break;
+        case Type::JSON_DOUBLE:
+            writeDouble(*json.valueDouble());
+            break;
+        case Type::JSON_STRING:
+            writeString(*json.getString());
+            break;
+        case Type::JSON_ARRAY: {
+            beginArray(json.size().value());
+            if (const auto *ints = json.getIntArray()) {
+                for (int v : *ints) { writeInt(v); }
+            } else if (const auto *doubles = json.getDoubleArray()) {
+                for (double v : *doubles) { writeDouble(v); }
+            } else {
+                for (const auto &v : *json.getArray()) { write(v); }
+            }
+            break;
+        }
+        case Type::JSON_OBJECT: {
+            const auto *obj = json.getObject();
+            beginMap(obj->size());
+            for (const auto &[k, v] : *obj) {
+                writeString(k);
+                write(v);
+            }
+            break;
+        }
+    }
+}
+
+MsgpackReader::MsgpackReader(std::string_view data) : _data(data), _pos(0) {
+}
+
+std::uint64_t MsgpackReader::get(int bytes) {
+    if (_data.size() - _pos < static_cast<std::size_t>(bytes)) {
+        throw std::logic_error("msgpack truncated !");
+    }
+    std::uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value = (value << 8) | static_cast<std::uint8_t>(_data[_pos++]);
+    }
+    return value;
+}
+
+std::string_view MsgpackReader::bytes(std::uint64_t size) {
+    if (_data.size() - _pos < size) {
+        throw std::logic_error("msgpack truncated !");
+    }
+    std::string_view ret = _data.substr(_pos, size);
+    _pos += size;
+    return ret;
+}
+
+BinaryItem MsgpackReader::next() {
+    BinaryItem item;
+    auto tag = static_cast<std::uint8_t>(get(1));
+    if (tag < 0x80) {
+        item.type = Type::JSON_INT;
+        item.integer = tag;
+    } else if (tag < 0x90) {
+        item.type = Type::JSON_OBJECT;
+        item.size = tag & 0x0f;
+    } else if (tag < 0xa0) {
+        item.type = Type::JSON_ARRAY;
+        item.size = tag & 0x0f;
+    } else if (tag < 0xc0) {
+        item.type = Type::JSON_STRING;
+        item.string = bytes(tag & 0x1f);
+    } else if (tag >= 0xe0) {
+        item.type = Type::JSON_INT;
+        item.integer = static_cast<std::int8_t>(tag);
+    } else {
+        switch (tag) {
+            case 0xc0:
+                break;
+            case 0xc2:
+            case 0xc3:
+                item.type = Type::JSON_BOOL;
+                item.boolean = tag == 0xc3;
+                break;
+            case 0xc4:
+            case 0xc5:
+            case 0xc6:
+                // bin 8/16/32, surfaced as strings
+                item.type = Type::JSON_STRING;
+                item.string = bytes(get(1 << (tag - 0xc4)));
+                break;
+            case 0xca: {
+                auto bits = static_cast<std::uint32_t>(get(4));
+                float value;
+                std::memcpy(&value, &bits, sizeof(value));
+                item.type = Type::JSON_DOUBLE;
+                item.number = value;
+                break;
+            }
+            case 0xcb: {
+                std::uint64_t bits = get(8);
+                std::memcpy(&item.number, &bits, sizeof(item.number));
+                item.type = Type::JSON_DOUBLE;
+                break;
+            }
+            case 0xcc:
+            case 0xcd:
+            case 0xce:
+            case 0xcf: {
+                std::uint64_t value = get(1 << (tag - 0xcc));
+                if (value > INT64_MAX) {
+                    item.type = Type::JSON_DOUBLE;
+                    item.number = static_cast<double>(value);
+                } else {
+                    item.type = Type::JSON_INT;
+                    item.integer = static_cast<std::int64_t>(value);
+                }
+                break;
+            }
+            case 0xd0:
+                item.type = Type::JSON_INT;
+                item.integer = static_cast<std::int8_t>(get(1));
+                break;
+            case 0xd1:
+                item.type = Type::JSON_INT;
+                item.integer = static_cast<std::int16_t>(get(2));
+                break;
+            case 0xd2:
+                item.type = Type::JSON_INT;
+                item.integer = static_cast<std::int32_t>(get(4));
+                break;
+            case 0xd3:
+                item.type = Type::JSON_INT;
+                item.integer = static_cast<std::int64_t>(get(8));
+                break;
+            case 0xd9:
+            case 0xda:
+            case 0xdb:
+                item.type = Type::JSON_STRING;
+                item.string = bytes(get(1 << (tag - 0xd9)));
+                break;
+            case 0xdc:
+            case 0xdd:
+                item.type = Type::JSON_ARRAY;
+                item.size = get(tag == 0xdc ? 2 : 4);
+                break;
+            case 0xde:
+            case 0xdf:
+                item.type = Type::JSON_OBJECT;
+                item.size = get(tag == 0xde ? 2 : 4);
+                break;
+            default:
+                throw std::logic_error("msgpack type is not supported !");
+        }
+    }
+    // Every element takes at least one byte, reject impossible counts
+    // before anyone reserves memory for them.
+    if ((item.type == Type::JSON_ARRAY || item.type == Type::JSON_OBJECT)
+        && item.size > _data.size() - _pos) {
+        throw std::logic_error("msgpack truncated !");
+    }
+    return item;
+}
+
+Json MsgpackReader::read() {
+    return readBinaryJson(*this);
+}
+
+std::size_t MsgpackReader::position() const {
+    return _pos;
+}
+
+bool MsgpackReader::done() const {
+    return _pos == _data.size();
+}
+
+std::string eee::toMsgpack(const Json &json) {
+    std::string out;
+    MsgpackWriter(out).write(json);
+    return out;
+}
+
+Json eee::fromMsgpack(std::string_view data) {
+    MsgpackReader reader(data);
+    Json ret = reader.read();
+    if (!reader.done()) { throw std::logic_error("msgpack trailing data !"); }
+    return ret;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "binary.hh"
+#include "json.hh"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace eee {
+
+//! \brief Streaming MessagePack encoder. Values are appended to a caller
+//! owned buffer as they are written; containers are opened with their element
+//! count and their elements are written right after.
+class MsgpackWriter {
+  private:
+    //! \brief Output buffer
+    std::string &_out;
+
+    //! \brief Append a type byte followed by a big-endian integer
+    void put(std::uint8_t tag, std::uint64_t value, int bytes);
+
+  public:
+    //! \brief Construct a MsgpackWriter appending to out.
+    explicit MsgpackWriter(std::string &out);
+
+    void writeNull();
+    void writeBool(bool value);
+    void writeInt(std::int64_t value);
+    //! \brief Write a double, as float32 if that is lossless.
+    void writeDouble(double value);
+    void writeString(std::string_view value);
+    //! \brief Open an array, the next size values are its elements.
+    void beginArray(std::size_t size);
+    //! \brief Open a map, the next 2 * size values are its keys and values.
+    void beginMap(std::size_t size);
+    //! \brief Write a complete Json value.
+    void write(const Json &json);
+};
+
+//! \brief Zero-copy MessagePack decoder. Items are read one header at a time
+//! and strings are returned as views into the input buffer, which must
+//! outlive them.
+class MsgpackReader {
+  private:
+    //! \brief Encoded input
+    std::string_view _data;
+    //! \brief Offset of the next item
+    std::size_t _pos;
+
+    //! \brief Read a big-endian unsigned integer of the given width
+    std::uint64_t get(int bytes);
+    //! \brief Read a string of the given length
+    std::string_view bytes(std::uint64_t size);
+
+  public:
+    //! \brief Construct a MsgpackReader over data.
+    explicit MsgpackReader(std::string_view data);
+
+    //! \brief Decode the next item header.
+    BinaryItem next();
+    //! \brief MessagePack has no indefinite containers.
+    //! \return 'false'
+    bool nextIsBreak() const { return false; }
+    //! \brief Decode one complete value into a Json.
+    Json read();
+    //! \brief Offset of the next item in the input.
+    std::size_t position() const;
+    //! \return 'true' if the whole input has been consumed.
+    bool done() const;
+};
+
+//! \brief Encode a Json as MessagePack.
+std::string toMsgpack(const Json &json);
+//! \brief Decode a MessagePack document into a Json.
+Json fromMsgpack(std::string_view data);
+
+} // namespace eee
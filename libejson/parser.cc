@@ -1,20 +1,72 @@
 #include "parser.hh"
+#include "utf8.hh"
 #include <stdexcept>
 #include <optional>
 #include <iostream>
 #include <cerrno>
+#include <climits>
 #include <cstdlib>
 #include <cmath>
+#include <exception>
+#include <thread>
 
 using namespace eee;
 
-Parser::Parser() : _tokens(nullptr), _data(), _pos(0) {
+Parser::Parser()
+    : _tokens(), _view(), _data(), _pos(0), _key(), _strictUtf8(false)
+    , _arrays(), _depth(0), _text(), _memoryLimit(0), _keepValue(true)
+    , _numericArrays(false) {
 }
 
-Parser::Parser(const std::string &data) : _tokens(data), _data(), _pos(0) {
+Parser::Parser(const std::string &data)
+    : _tokens(data), _view(_tokens), _data(), _pos(0), _key()
+    , _strictUtf8(false), _arrays(), _depth(0), _text()
+    , _memoryLimit(0), _keepValue(true), _numericArrays(false) {
     Parser::parse();
 }
 
+void Parser::setStrictUtf8(bool strict) {
+    _strictUtf8 = strict;
+}
+
+void Parser::setNumericArrays(bool numeric) {
+    _numericArrays = numeric;
+}
+
+void Parser::setMemoryLimit(std::size_t bytes) {
+    _memoryLimit = bytes;
+}
+
+void Parser::setKeepValue(bool keep) {
+    _keepValue = keep;
+    if (!keep) { _data = nullptr; }
+}
+
+std::size_t Parser::scratchCapacity() const {
+    std::size_t bytes = _tokens.capacity() + _key.capacity() + _text.capacity();
+    for (const auto &items : _arrays) {
+        bytes += items.capacity() * sizeof(Json);
+    }
+    return bytes;
+}
+
+void Parser::limit_scratch() {
+    if (_memoryLimit == 0 || scratchCapacity() <= _memoryLimit) { return; }
+    // _tokens is still viewed by _view, parse(data) replaces it.
+    std::deque<std::vector<Json>>().swap(_arrays);
+    std::string().swap(_key);
+    std::string().swap(_text);
+}
+
+void Parser::trim() {
+    std::string().swap(_tokens);
+    _view = std::string_view();
+    _pos = 0;
+    std::deque<std::vector<Json>>().swap(_arrays);
+    std::string().swap(_key);
+    std::string().swap(_text);
+}
+
 Json Parser::getValue() {
     return _data;
 }
@@ -24,16 +76,20 @@ void Parser::clear() {
     _data = nullptr;
 }
 
+char Parser::at(std::size_t i) const {
+    return i < _view.size() ? _view[i] : '\0';
+}
+
 void Parser::parse_whitespace() {
-    while ((_pos < _tokens.size())
-           && (_tokens[_pos] == '\t' || _tokens[_pos] == '\n'
-               || _tokens[_pos] == '\r' || _tokens[_pos] == ' ')) {
+    while ((_pos < _view.size())
+           && (_view[_pos] == '\t' || _view[_pos] == '\n'
+               || _view[_pos] == '\r' || _view[_pos] == ' ')) {
         this->_pos++;
     }
 }
 
 Json Parser::parse_null() {
-    if (_tokens.find("null", _pos) != _pos) {
+    if (_view.compare(_pos, 4, "null") != 0) {
         throw std::logic_error("value is not NULL ! ");
     }
     _pos += 4;
@@ -42,13 +98,13 @@ Json Parser::parse_null() {
 
 Json Parser::parse_bool(bool flag) {
     if (flag) {
-        if (_tokens.find("true", _pos) != _pos) {
+        if (_view.compare(_pos, 4, "true") != 0) {
             throw std::logic_error("value is not TRUE ! ");
         }
         _pos += 4;
         return Json(true);
     }
-    if (_tokens.find("false", _pos) != _pos) {
+    if (_view.compare(_pos, 5, "false") != 0) {
         throw std::logic_error("value is not FALSE ! ");
     }
     _pos += 5;
@@ -56,121 +112,134 @@ Json Parser::parse_bool(bool flag) {
 }
 
 Json Parser::parse_number() {
-    int tmp = _pos, m = _tokens.size();
+    std::size_t tmp = _pos, m = _view.size();
     bool flag = false;
-    if (_tokens[tmp] == '-') tmp++;
-    if (_tokens[tmp] == '0') tmp++;
+    if (at(tmp) == '-') tmp++;
+    if (at(tmp) == '0') tmp++;
     else {
-        if (_tokens[tmp] < '0' || _tokens[tmp] > '9')
+        if (at(tmp) < '0' || at(tmp) > '9')
             throw std::logic_error("value is not number !");
-        for (; tmp < m && (_tokens[tmp] >= '0' && _tokens[tmp] <= '9'); tmp++)
+        for (; tmp < m && (at(tmp) >= '0' && at(tmp) <= '9'); tmp++)
             ;
     }
-    if (_tokens[tmp] == '.') {
+    if (at(tmp) == '.') {
         tmp++;
-        if (_tokens[tmp] < '0' || _tokens[tmp] > '9')
+        if (at(tmp) < '0' || at(tmp) > '9')
             throw std::logic_error("value is not number !");
         flag = true;
-        for (; tmp < m && (_tokens[tmp] >= '0' && _tokens[tmp] <= '9'); tmp++)
+        for (; tmp < m && (at(tmp) >= '0' && at(tmp) <= '9'); tmp++)
             ;
     }
-    if (_tokens[tmp] == 'e' || _tokens[tmp] == 'E') {
+    if (at(tmp) == 'e' || at(tmp) == 'E') {
         tmp++;
-        if (_tokens[tmp] == '+' || _tokens[tmp] == '-') tmp++;
-        if (_tokens[tmp] < '0' || _tokens[tmp] > '9')
+        if (at(tmp) == '+' || at(tmp) == '-') tmp++;
+        if (at(tmp) < '0' || at(tmp) > '9')
             throw std::logic_error("value is not number !");
         flag = true;
-        for (; tmp < m && (_tokens[tmp] >= '0' && _tokens[tmp] <= '9'); tmp++)
+        for (; tmp < m && (at(tmp) >= '0' && at(tmp) <= '9'); tmp++)
             ;
     }
     errno = 0;
-    double data = std::strtod(_tokens.c_str() + _pos, nullptr);
+    double data = std::strtod(_view.data() + _pos, nullptr);
     if (errno == ERANGE && (data == HUGE_VAL || data == -HUGE_VAL))
         throw std::logic_error("value is not number !");
     _pos = tmp;
-    if (flag) return Json(data);
+    // Integers outside the int range stay doubles, converting them is
+    // undefined.
+    if (flag || data < INT_MIN || data > INT_MAX) return Json(data);
     return Json((int)data);
 }
 
 Json Parser::parse_string() {
-    std::string data;
+    Parser::parse_chars(_text);
+    // One allocation of the final size, _text keeps its capacity.
+    return Json(std::string(_text));
+}
+
+void Parser::parse_chars(std::string &out) {
+    out.clear();
     _pos++;
-    size_t m = _tokens.size();
-    for (; _pos < m; _pos++) {
-        switch (_tokens[_pos]) {
-            case '\\': {
-                if (_pos + 1 < m) {
-                    throw std::logic_error("String index failed !");
-                }
-                _pos++;
-                switch (_tokens[_pos]) {
-                    case '\"':
-                        data.push_back('\"');
-                        break;
-                    case '\\':
-                        data.push_back('\\');
-                        break;
-                    case 't':
-                        data.push_back('\t');
-                        break;
-                    case '/':
-                        data.push_back('/');
-                        break;
-                    case 'b':
-                        data.push_back('\b');
-                        break;
-                    case 'f':
-                        data.push_back('\f');
-                        break;
-                    case 'n':
-                        data.push_back('\n');
-                        break;
-                    case 'r':
-                        data.push_back('\r');
-                        break;
-                    case 'u': {
-                        for (int i = 0; i < 4; i++, _pos++)
-                            data.push_back(_tokens[_pos]);
-                        break;
-                    }
-                    default:
-                        throw std::logic_error(" string \\ failed !");
-                }
-                break;
-            }
-            case '\0': {
-                throw std::logic_error(" string \\0 failed ! ");
-            }
-            case '\"': {
-                _pos++;
-                return Json(data);
-            }
-            default: {
-                if ((unsigned char)_tokens[_pos] < 0x20) {
-                    throw std::logic_error(" string failed ! ");
-                }
-                data.push_back(_tokens[_pos]);
-            }
+    const size_t m = _view.size();
+    while (_pos < m) {
+        // Copy the run up to the next quote, escape or invalid byte at once.
+        size_t run =
+            scanStringRun(_view.data() + _pos, m - _pos, _strictUtf8);
+        out.append(_view.data() + _pos, run);
+        _pos += run;
+        if (_pos >= m) { break; }
+        const char c = _view[_pos];
+        if (c == '\"') {
+            _pos++;
+            return;
         }
+        if (c == '\\') {
+            _pos = decodeEscape(_view, _pos + 1, out);
+            if (_pos == 0) { throw std::logic_error(" string \\ failed !"); }
+            continue;
+        }
+        if (c == '\0') { throw std::logic_error(" string \\0 failed ! "); }
+        if ((unsigned char)c < 0x20) {
+            throw std::logic_error(" string failed ! ");
+        }
+        throw std::logic_error(" string UTF-8 failed ! ");
     }
     throw std::logic_error(" string end failed ! ");
 }
 
+const std::string &Parser::parse_key() {
+    if (at(_pos) != '"') { throw std::logic_error("key failed !"); }
+    const std::size_t begin = _pos + 1;
+    const std::size_t m = _view.size();
+    const std::size_t end =
+        begin + scanStringRun(_view.data() + begin, m - begin, _strictUtf8);
+    if (end < m && _view[end] == '"') {
+        // Plain key: copy the raw bytes without decoding them.
+        _key.assign(_view.data() + begin, end - begin);
+        _pos = end + 1;
+        return _key;
+    }
+    Parser::parse_chars(_key);
+    return _key;
+}
+
 Json Parser::parse_array() {
-    std::vector<Json> data;
+    // Nested arrays may add depths, so _arrays is indexed anew each time.
+    const std::size_t depth = _depth++;
+    if (depth == _arrays.size()) { _arrays.emplace_back(); }
     _pos++;
-    size_t m = _tokens.size();
+    Parser::parse_whitespace();
+    if (at(_pos) == ']') {
+        _pos++;
+        _depth--;
+        return Json(Type::JSON_ARRAY);
+    }
+    size_t m = _view.size();
     for (; _pos < m;) {
         Parser::parse_whitespace();
 
-        data.emplace_back(Parser::parse_value());
+        Json value = Parser::parse_value();
+        _arrays[depth].emplace_back(std::move(value));
 
         Parser::parse_whitespace();
 
-        if (_tokens[_pos] == ']') {
+        if (at(_pos) == ']') {
             _pos++;
-            return Json(data);
-        } else if (_tokens[_pos] == ',') {
+            std::vector<Json> &items = _arrays[depth];
+            if (_numericArrays) {
+                Json numbers = Parser::numeric_array(items);
+                if (!numbers.isNull()) {
+                    items.clear();
+                    _depth--;
+                    return numbers;
+                }
+            }
+            std::vector<Json> data(
+                std::make_move_iterator(items.begin()),
+                std::make_move_iterator(items.end()));
+            items.clear();
+            _depth--;
+            return Json(std::move(data));
+        } else if (at(_pos) == ',') {
             _pos++;
             continue;
         } else {
@@ -183,25 +252,29 @@ Json Parser::parse_array() {
 Json Parser::parse_object() {
     std::map<std::string, Json> data;
     _pos++;
-    size_t m = _tokens.size();
+    Parser::parse_whitespace();
+    if (at(_pos) == '}') {
+        _pos++;
+        return Json(std::move(data));
+    }
+    size_t m = _view.size();
     for (; _pos < m;) {
         Parser::parse_whitespace();
-        if (_tokens[_pos] != '"') { std::logic_error("key failed !"); }
-        std::optional<std::string> tmp = Parser::parse_string().valueString();
-        if (!tmp) { std::logic_error("key failed !"); }
-        std::string key = tmp.value();
+        Json &value = data[Parser::parse_key()];
         Parser::parse_whitespace();
 
-        if (_tokens[_pos] != ':') { std::logic_error(": failed (object) !"); }
+        if (at(_pos) != ':') {
+            throw std::logic_error(": failed (object) !");
+        }
 
         _pos++;
-        data[key] = Parser::parse_value();
+        value = Parser::parse_value();
         Parser::parse_whitespace();
 
-        if (_tokens[_pos] == '}') {
+        if (at(_pos) == '}') {
             _pos++;
-            return Json(data);
-        } else if (_tokens[_pos] == ',') {
+            return Json(std::move(data));
+        } else if (at(_pos) == ',') {
             _pos++;
             continue;
         } else {
@@ -213,7 +286,7 @@ Json Parser::parse_object() {
 
 Json Parser::parse_value() {
     Parser::parse_whitespace();
-    switch (_tokens[_pos]) {
+    switch (at(_pos)) {
         case 'n':
             return parse_null();
         case 't':
@@ -233,15 +306,248 @@ Json Parser::parse_value() {
 }
 
 Json Parser::parse() {
+    // A previous parse may have thrown half way through an array.
+    for (std::size_t i = 0; i < _depth && i < _arrays.size(); i++) {
+        _arrays[i].clear();
+    }
+    _depth = 0;
     Json data = Parser::parse_value();
     Parser::parse_whitespace();
-    if (_tokens.size() > _pos) { std::logic_error("parse is failed ! "); }
+    if (_view.size() > _pos) { throw std::logic_error("parse is failed ! "); }
+    Parser::limit_scratch();
+    if (!_keepValue) { return data; }
     return _data = std::move(data);
 }
 
 Json Parser::parse(const std::string &data) {
     Parser::clear();
+    if (_memoryLimit != 0 && _tokens.capacity() > _memoryLimit
+        && data.size() <= _memoryLimit) {
+        std::string().swap(_tokens);
+    }
     _tokens = data;
+    _view = _tokens;
     _pos = 0;
     return Parser::parse();
-}
\ No newline at end of file
+}
+
+Json Parser::parseView(std::string_view data) {
+    Parser::clear();
+    _view = data;
+    // Point back at _tokens afterwards, data may not outlive the call.
+    try {
+        Json ret = Parser::parse();
+        _view = _tokens;
+        return ret;
+    } catch (...) {
+        _view = _tokens;
+        throw;
+    }
+}
+
+Json Parser::numeric_array(const std::vector<Json> &items) {
+    bool ints = true, doubles = true;
+    for (const Json &item : items) {
+        ints = ints && item.isInt();
+        doubles = doubles && item.isDouble();
+        if (!ints && !doubles) { return Json(); }
+    }
+    if (ints) {
+        std::vector<int> data;
+        data.reserve(items.size());
+        for (const Json &item : items) { data.push_back(*item.valueInt()); }
+        return Json(std::move(data));
+    }
+    std::vector<double> data;
+    data.reserve(items.size());
+    for (const Json &item : items) { data.push_back(*item.valueDouble()); }
+    return Json(std::move(data));
+}
+
+void Parser::parse_elements(std::vector<Json> &data) {
+    Parser::parse_whitespace();
+    while (_pos < _view.size()) {
+        data.emplace_back(Parser::parse_value());
+        Parser::parse_whitespace();
+        if (_pos == _view.size()) { return; }
+        if (at(_pos) != ',') { throw std::logic_error("array parse failed !"); }
+        _pos++;
+        Parser::parse_whitespace();
+        if (_pos == _view.size()) {
+            throw std::logic_error("array parse failed !");
+        }
+    }
+}
+
+void Parser::parse_members(std::map<std::string, Json> &data) {
+    Parser::parse_whitespace();
+    while (_pos < _view.size()) {
+        Json &value = data[Parser::parse_key()];
+        Parser::parse_whitespace();
+        if (at(_pos) != ':') { throw std::logic_error(": failed (object) !"); }
+        _pos++;
+        value = Parser::parse_value();
+        Parser::parse_whitespace();
+        if (_pos == _view.size()) { return; }
+        if (at(_pos) != ',') {
+            throw std::logic_error("object parse failed !");
+        }
+        _pos++;
+        Parser::parse_whitespace();
+        if (_pos == _view.size()) {
+            throw std::logic_error("object parse failed !");
+        }
+    }
+}
+
+namespace {
+
+//! Inputs smaller than this are not worth the thread start-up cost.
+constexpr std::size_t kParallelMinSize = 1 << 20;
+//! Smallest slice handed to a single worker.
+constexpr std::size_t kParallelMinChunk = 1 << 16;
+
+bool is_whitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+//! \brief Structural pre-scan of the content of a top-level container.
+//! Tracks string and nesting state and records, for each of the parts - 1
+//! evenly spaced split targets, the first top-level comma at or after it.
+//! \return 'false' if the content is not balanced; the caller then lets the
+//! sequential parser report the error.
+bool split_top_level(
+    std::string_view content,
+    std::size_t parts,
+    std::vector<std::size_t> &cuts) {
+    std::size_t depth = 0;
+    std::size_t next = 1;
+    std::size_t target = content.size() / parts;
+    const char *p = content.data();
+    const std::size_t n = content.size();
+    for (std::size_t i = 0; i < n; i++) {
+        switch (p[i]) {
+            case '"':
+                for (i++; i < n && p[i] != '"'; i++) {
+                    if (p[i] == '\\') { i++; }
+                }
+                if (i >= n) { return false; }
+                break;
+            case '[':
+            case '{':
+                depth++;
+                break;
+            case ']':
+            case '}':
+                if (depth == 0) { return false; }
+                depth--;
+                break;
+            case ',':
+                if (depth == 0 && next < parts && i >= target) {
+                    cuts.push_back(i);
+                    next++;
+                    target = content.size() / parts * next;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return depth == 0;
+}
+
+} // namespace
+
+Json Parser::parseParallel(const std::string &data, std::size_t threads) {
+    if (threads == 0) { threads = std::thread::hardware_concurrency(); }
+    if (threads > data.size() / kParallelMinChunk) {
+        threads = data.size() / kParallelMinChunk;
+    }
+    if (threads <= 1 || data.size() < kParallelMinSize) {
+        return Parser::parse(data);
+    }
+
+    std::size_t begin = 0, end = data.size();
+    while (begin < end && is_whitespace(data[begin])) { begin++; }
+    while (end > begin && is_whitespace(data[end - 1])) { end--; }
+    if (end - begin < 2) { return Parser::parse(data); }
+    const char open = data[begin], close = data[end - 1];
+    if (!((open == '[' && close == ']') || (open == '{' && close == '}'))) {
+        return Parser::parse(data);
+    }
+
+    Parser::clear();
+    _tokens = data;
+    _view = _tokens;
+    _pos = 0;
+
+    // Content between the outer brackets, split at top-level commas.
+    std::string_view content = _view.substr(begin + 1, end - begin - 2);
+    std::vector<std::size_t> cuts;
+    cuts.reserve(threads);
+    if (!split_top_level(content, threads, cuts)) { return Parser::parse(); }
+
+    std::vector<std::string_view> ranges;
+    std::size_t from = 0;
+    for (std::size_t cut : cuts) {
+        ranges.push_back(content.substr(from, cut - from));
+        from = cut + 1;
+    }
+    ranges.push_back(content.substr(from));
+
+    const bool isArray = open == '[';
+    std::vector<std::vector<Json>> arrays(isArray ? ranges.size() : 0);
+    std::vector<std::map<std::string, Json>> objects(
+        isArray ? 0 : ranges.size());
+    std::vector<std::exception_ptr> errors(ranges.size());
+
+    auto work = [&](std::size_t i) {
+        try {
+            Parser worker;
+            worker._view = ranges[i];
+            worker._strictUtf8 = _strictUtf8;
+            worker._numericArrays = _numericArrays;
+            if (isArray) {
+                worker.parse_elements(arrays[i]);
+            } else {
+                worker.parse_members(objects[i]);
+            }
+        } catch (...) { errors[i] = std::current_exception(); }
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(ranges.size() - 1);
+    for (std::size_t i = 1; i < ranges.size(); i++) {
+        pool.emplace_back(work, i);
+    }
+    work(0);
+    for (auto &t : pool) { t.join(); }
+    for (auto &e : errors) {
+        if (e) { std::rethrow_exception(e); }
+    }
+    // A lone empty range is an empty container; any other empty range
+    // comes from a stray comma.
+    if (ranges.size() > 1) {
+        for (std::size_t i = 0; i < ranges.size(); i++) {
+            bool empty = isArray ? arrays[i].empty() : objects[i].empty();
+            if (empty) { throw std::logic_error("parse is failed ! "); }
+        }
+    }
+
+    _pos = end;
+    if (isArray) {
+        std::size_t total = 0;
+        for (auto &part : arrays) { total += part.size(); }
+        std::vector<Json> result;
+        result.reserve(total);
+        for (auto &part : arrays) {
+            for (auto &v : part) { result.emplace_back(std::move(v)); }
+        }
+        return Json(std::move(result));
+    }
+    // Later members win, as in the sequential parser.
+    std::map<std::string, Json> result = std::move(objects.back());
+    for (std::size_t i = objects.size() - 1; i-- > 0;) {
+        result.merge(objects[i]);
+    }
+    return Json(std::move(result));
+}
@@ -2,6 +2,8 @@
 
 #include "json.hh"
 #include <cstddef>
+#include <deque>
+#include <string_view>
 
 namespace eee {
 
@@ -11,12 +13,37 @@ class Parser {
   private:
     //! \brief The JSON data that needs to be parsed
     std::string _tokens;
+    //! \brief The range of the JSON data being parsed. Usually views all of
+    //! _tokens, a worker of parseParallel() views one slice of it.
+    std::string_view _view;
     //! \brief Parsed JSON data
     Json _data;
     //! \brief A _tokens that indicates which subscript of the tokens is
     //! resolved
     std::size_t _pos;
+    //! \brief Decoded key scratch
+    std::string _key;
+    //! \brief Reject strings that are not well-formed UTF-8
+    bool _strictUtf8;
+    //! \brief Element scratch of the arrays being parsed, one per nesting
+    //! depth. Kept across parse() calls, so a result array is allocated once
+    //! at its final size instead of growing.
+    std::deque<std::vector<Json>> _arrays;
+    //! \brief Nesting depth of the array being parsed
+    std::size_t _depth;
+    //! \brief Decoded string scratch
+    std::string _text;
+    //! \brief Scratch bytes kept between parse() calls, 0 for no limit
+    std::size_t _memoryLimit;
+    //! \brief 'false' if parse() hands its result over instead of keeping a
+    //! copy for getValue()
+    bool _keepValue;
+    //! \brief Store arrays of only ints or only doubles contiguously
+    bool _numericArrays;
 
+    //! \brief Get the character at index i of _view
+    //! \return '\0' if i is out of range
+    char at(std::size_t i) const;
     //! \brief Parse white space
     void parse_whitespace();
     //! \brief Parse the function that startsResolve
@@ -30,10 +57,24 @@ class Parser {
     Json parse_number();
     //! \brief Parse String
     Json parse_string();
+    //! \brief Decode the string at _pos into out, replacing its contents
+    void parse_chars(std::string &out);
+    //! \brief Parse an object key
+    //! \return The key, only valid until the next key is parsed.
+    const std::string &parse_key();
     //! \brief Parse array
     Json parse_array();
     //! \brief Parse object
     Json parse_object();
+    //! \brief Parse comma separated array elements up to the end of _view
+    void parse_elements(std::vector<Json> &data);
+    //! \brief Parse comma separated object members up to the end of _view
+    void parse_members(std::map<std::string, Json> &data);
+    //! \brief Numeric storage for items if they are all ints or all doubles
+    //! \return null if they are not
+    Json numeric_array(const std::vector<Json> &items);
+    //! \brief Release the scratch buffers if they hold more than _memoryLimit
+    void limit_scratch();
 
   public:
     Parser();
@@ -49,12 +90,47 @@ class Parser {
     //! \param data Assign a value to the _tokens
     //! \return Returns the parsed data structure
     Json parse(const std::string &data);
+    //! \brief parse data in place, without copying it into _tokens
+    //! \param data Text that must stay valid until the call returns
+    //! \return Returns the parsed data structure
+    Json parseView(std::string_view data);
+    //! \brief parse tokens on multiple threads. A structural pre-scan splits
+    //! the elements of a top-level array (or the members of a top-level
+    //! object) into ranges that are parsed concurrently and then combined.
+    //! Small inputs and scalar documents fall back to parse(). The result is
+    //! not kept for getValue(), so a large document is never copied.
+    //! \param data Assign a value to the _tokens
+    //! \param threads Number of worker threads, 0 for hardware concurrency
+    //! \return Returns the parsed data structure
+    Json parseParallel(const std::string &data, std::size_t threads = 0);
 
     //! \brief Get the parsed data structure
     //! \return Returns the parsed data structure
     Json getValue();
 
     void clear();
+
+    //! \brief Reject input whose strings are not well-formed UTF-8. The check
+    //! runs inside the string scan, so ASCII text costs nothing extra.
+    void setStrictUtf8(bool strict);
+    //! \brief Bound the scratch memory kept between parse() calls. Buffers
+    //! that grew past bytes on a large document are released after it, the
+    //! input copy once a smaller document arrives. 0 (the default) keeps
+    //! everything.
+    void setMemoryLimit(std::size_t bytes);
+    //! \brief Keep a copy of each result for getValue() (the default).
+    //! Without it parse() moves the result out, saving a deep copy per
+    //! document, and getValue() returns null.
+    void setKeepValue(bool keep);
+    //! \brief Store each array whose elements are all ints, or all doubles,
+    //! as a contiguous std::vector<int> or std::vector<double> instead of
+    //! one Json per element, see Json::getIntArray(). Mixed arrays keep
+    //! generic storage.
+    void setNumericArrays(bool numeric);
+    //! \brief Bytes of scratch and input buffers currently held
+    std::size_t scratchCapacity() const;
+    //! \brief Release all scratch buffers and the copy of the input.
+    void trim();
 };
 
 } // namespace eee
\ No newline at end of file
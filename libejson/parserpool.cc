@@ -0,0 +1,63 @@
+#include "parserpool.hh"
+#include <utility>
+
+using namespace eee;
+
+ParserPool::Lease::Lease(ParserPool *pool, std::unique_ptr<Parser> parser)
+    : _pool(pool), _parser(std::move(parser)) {
+}
+
+ParserPool::Lease::~Lease() {
+    // A moved-from lease has nothing to return.
+    if (_parser != nullptr) { _pool->release(std::move(_parser)); }
+}
+
+Parser &ParserPool::Lease::operator*() const {
+    return *_parser;
+}
+
+Parser *ParserPool::Lease::operator->() const {
+    return _parser.get();
+}
+
+ParserPool::ParserPool(std::size_t maxIdle, std::size_t memoryLimit)
+    : _idle(), _mutex(), _maxIdle(maxIdle), _memoryLimit(memoryLimit) {
+}
+
+ParserPool::Lease ParserPool::acquire() {
+    std::unique_ptr<Parser> parser;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_idle.empty()) {
+            parser = std::move(_idle.back());
+            _idle.pop_back();
+        }
+    }
+    if (parser == nullptr) { parser = std::make_unique<Parser>(); }
+    reset(*parser, _memoryLimit);
+    return Lease(this, std::move(parser));
+}
+
+void ParserPool::release(std::unique_ptr<Parser> parser) {
+    parser->clear();
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_idle.size() < _maxIdle) { _idle.push_back(std::move(parser)); }
+}
+
+void ParserPool::reset(Parser &parser, std::size_t memoryLimit) {
+    parser.setStrictUtf8(false);
+    parser.setNumericArrays(false);
+    parser.setKeepValue(false);
+    parser.setMemoryLimit(memoryLimit);
+}
+
+std::size_t ParserPool::idle() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _idle.size();
+}
+
+Parser &ParserPool::local() {
+    thread_local Parser parser;
+    reset(parser, kDefaultMemoryLimit);
+    return parser;
+}
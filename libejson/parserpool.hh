@@ -0,0 +1,80 @@
+#pragma once
+
+#include "parser.hh"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace eee {
+
+//! \brief A pool of reusable Parsers for servers parsing many documents.
+//!
+//! A Parser keeps its scratch buffers across parse() calls, so a warmed up
+//! parser only allocates the result. acquire() lends an idle parser (or a new
+//! one) and the Lease returns it when destroyed. Pooled parsers hand their
+//! results over instead of keeping a copy (see Parser::setKeepValue()) and
+//! release scratch beyond the memory limit, so one huge request does not pin
+//! its buffers for good.
+class ParserPool {
+  public:
+    //! \brief Scratch bytes a pooled parser keeps by default
+    static constexpr std::size_t kDefaultMemoryLimit = 1 << 20;
+
+    //! \brief A Parser borrowed from a pool
+    class Lease {
+      private:
+        ParserPool *_pool;
+        std::unique_ptr<Parser> _parser;
+
+      public:
+        Lease(ParserPool *pool, std::unique_ptr<Parser> parser);
+        Lease(Lease &&other) noexcept = default;
+        Lease &operator=(Lease &&other) noexcept = delete;
+        //! \brief Give the parser back to the pool
+        ~Lease();
+
+        Parser &operator*() const;
+        Parser *operator->() const;
+    };
+
+  private:
+    //! \brief Parsers waiting to be lent
+    std::vector<std::unique_ptr<Parser>> _idle;
+    //! \brief Guards _idle
+    mutable std::mutex _mutex;
+    //! \brief Most parsers kept in _idle, the rest are destroyed on return
+    std::size_t _maxIdle;
+    //! \brief Parser::setMemoryLimit() of each pooled parser
+    std::size_t _memoryLimit;
+
+    //! \brief Take back a parser from a Lease
+    void release(std::unique_ptr<Parser> parser);
+    //! \brief Give parser the options of a pooled parser, undoing whatever
+    //! its last borrower set
+    static void reset(Parser &parser, std::size_t memoryLimit);
+
+  public:
+    //! \param maxIdle Most parsers kept between leases
+    //! \param memoryLimit Scratch bytes each pooled parser keeps
+    explicit ParserPool(
+        std::size_t maxIdle = 16,
+        std::size_t memoryLimit = kDefaultMemoryLimit);
+    ParserPool(const ParserPool &other) = delete;
+    ParserPool &operator=(const ParserPool &other) = delete;
+    //! \brief All leases must have ended before the pool is destroyed.
+    ~ParserPool() = default;
+
+    //! \brief Borrow a parser. Its options are reset: no strict UTF-8, no
+    //! numeric arrays, no kept value and the pool's memory limit.
+    Lease acquire();
+    //! \brief Number of parsers waiting to be lent
+    std::size_t idle() const;
+
+    //! \brief The calling thread's own parser, needing no locking. Every
+    //! call resets its options like acquire() does, with the default memory
+    //! limit.
+    static Parser &local();
+};
+
+} // namespace eee
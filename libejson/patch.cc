@@ -0,0 +1,355 @@
+#include "patch.hh"
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace eee;
+
+namespace {
+
+//! Elements of an array by index, whatever its storage. A numeric element
+//! is materialized in scratch, valid until the next call.
+class Elements {
+  private:
+    const Json &_array;
+    mutable Json _scratch;
+
+  public:
+    explicit Elements(const Json &array) : _array(array), _scratch() {}
+
+    std::size_t size() const { return _array.size().value(); }
+
+    const Json &operator[](std::size_t index) const {
+        if (const auto *ints = _array.getIntArray()) {
+            return _scratch = Json((*ints)[index]);
+        }
+        if (const auto *doubles = _array.getDoubleArray()) {
+            return _scratch = Json((*doubles)[index]);
+        }
+        return (*_array.getArray())[index];
+    }
+};
+
+//! Append token to a JSON Pointer, escaping '~' and '/' (RFC 6901).
+void append_token(std::string &path, std::string_view token) {
+    path.push_back('/');
+    for (char c : token) {
+        if (c == '~') {
+            path += "~0";
+        } else if (c == '/') {
+            path += "~1";
+        } else {
+            path.push_back(c);
+        }
+    }
+}
+
+void add_op(
+    std::vector<Json> &ops,
+    const char *op,
+    const std::string &path,
+    const Json *value) {
+    std::map<std::string, Json> item{
+        {"op", Json(op)}, {"path", Json(path)}};
+    if (value != nullptr) { item.emplace("value", *value); }
+    ops.emplace_back(std::move(item));
+}
+
+//! Structural hash of every array and object of a tree, by address.
+using Hashes = std::unordered_map<const Json *, std::size_t>;
+
+std::size_t mix(std::size_t seed, std::size_t value) {
+    return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+//! Hash json and record the hashes of it and every array and object below
+//! it in hashes, in one pass. Equal values hash alike whatever their array
+//! storage.
+std::size_t hash_tree(const Json &json, Hashes &hashes) {
+    std::size_t h = static_cast<std::size_t>(json.type());
+    if (const auto *object = json.getObject()) {
+        for (const auto &[key, value] : *object) {
+            h = mix(mix(h, std::hash<std::string>()(key)),
+                    hash_tree(value, hashes));
+        }
+    } else if (json.isArray()) {
+        const Elements items(json);
+        for (std::size_t i = 0; i < items.size(); i++) {
+            h = mix(h, hash_tree(items[i], hashes));
+        }
+    } else {
+        return json.hash();
+    }
+    hashes.emplace(&json, h);
+    return h;
+}
+
+//! Hashes of the two trees being diffed.
+struct Sides {
+    Hashes from;
+    Hashes to;
+};
+
+//! Whether a and b are equal. Arrays and objects whose hashes differ are
+//! rejected without being walked; matching hashes are confirmed with ==.
+bool same(const Json &a, const Json &b, const Sides &sides) {
+    auto i = sides.from.find(&a);
+    auto j = sides.to.find(&b);
+    if (i != sides.from.end() && j != sides.to.end()
+        && i->second != j->second) {
+        return false;
+    }
+    return a == b;
+}
+
+void diff_into(
+    const Json &from,
+    const Json &to,
+    const Sides &sides,
+    std::string &path,
+    std::vector<Json> &ops) {
+    if (same(from, to, sides)) { return; }
+    const std::size_t length = path.size();
+    if (from.isObject() && to.isObject()) {
+        // Both maps are sorted, walk them side by side.
+        const auto &a = *from.getObject();
+        const auto &b = *to.getObject();
+        auto i = a.begin();
+        auto j = b.begin();
+        while (i != a.end() || j != b.end()) {
+            if (j == b.end() || (i != a.end() && i->first < j->first)) {
+                append_token(path, i->first);
+                add_op(ops, "remove", path, nullptr);
+                ++i;
+            } else if (i == a.end() || j->first < i->first) {
+                append_token(path, j->first);
+                add_op(ops, "add", path, &j->second);
+                ++j;
+            } else {
+                append_token(path, i->first);
+                diff_into(i->second, j->second, sides, path, ops);
+                ++i;
+                ++j;
+            }
+            path.resize(length);
+        }
+        return;
+    }
+    if (!from.isArray() || !to.isArray()) {
+        add_op(ops, "replace", path, &to);
+        return;
+    }
+    const Elements a(from), b(to);
+    std::size_t n = a.size(), m = b.size(), prefix = 0;
+    while (prefix < n && prefix < m && same(a[prefix], b[prefix], sides)) {
+        prefix++;
+    }
+    while (n > prefix && m > prefix && same(a[n - 1], b[m - 1], sides)) {
+        n--;
+        m--;
+    }
+    std::size_t k = prefix;
+    for (; k < n && k < m; k++) {
+        append_token(path, std::to_string(k));
+        diff_into(a[k], b[k], sides, path, ops);
+        path.resize(length);
+    }
+    // Remove from the back so the indices of the rest stay put.
+    for (std::size_t r = n; r > k; r--) {
+        append_token(path, std::to_string(r - 1));
+        add_op(ops, "remove", path, nullptr);
+        path.resize(length);
+    }
+    for (; k < m; k++) {
+        append_token(path, std::to_string(k));
+        add_op(ops, "add", path, &b[k]);
+        path.resize(length);
+    }
+}
+
+//! Reference tokens of a JSON Pointer, unescaped.
+std::vector<std::string> tokens(const std::string &pointer) {
+    std::vector<std::string> result;
+    if (pointer.empty()) { return result; }
+    if (pointer[0] != '/') { throw std::logic_error("patch path failed !"); }
+    for (std::size_t i = 1;; i++) {
+        std::string &token = result.emplace_back();
+        for (; i < pointer.size() && pointer[i] != '/'; i++) {
+            if (pointer[i] != '~') {
+                token.push_back(pointer[i]);
+            } else if (i + 1 < pointer.size() && pointer[i + 1] == '0') {
+                token.push_back('~');
+                i++;
+            } else if (i + 1 < pointer.size() && pointer[i + 1] == '1') {
+                token.push_back('/');
+                i++;
+            } else {
+                throw std::logic_error("patch path failed !");
+            }
+        }
+        if (i >= pointer.size()) { return result; }
+    }
+}
+
+//! Array index of token, "-" meaning size when end is allowed.
+std::size_t index_of(const std::string &token, std::size_t size, bool end) {
+    if (end && token == "-") { return size; }
+    bool digits = !token.empty() && (token[0] != '0' || token.size() == 1);
+    for (char c : token) { digits = digits && c >= '0' && c <= '9'; }
+    if (!digits || token.size() > 9) {
+        throw std::logic_error("patch index failed !");
+    }
+    const std::size_t index = std::stoul(token);
+    if (index > size || (index == size && !end)) {
+        throw std::logic_error("patch index failed !");
+    }
+    return index;
+}
+
+//! The value at the first count tokens of path.
+Json &resolve(Json &root, const std::vector<std::string> &path,
+              std::size_t count) {
+    Json *node = &root;
+    for (std::size_t i = 0; i < count; i++) {
+        if (node->isObject()) {
+            auto it = node->find(path[i]);
+            if (it == node->getObject()->end()) {
+                throw std::logic_error("patch path failed !");
+            }
+            node = &it->second;
+        } else if (node->isArray()) {
+            node = &(*node)[index_of(path[i], node->size().value(), false)];
+        } else {
+            throw std::logic_error("patch path failed !");
+        }
+    }
+    return *node;
+}
+
+void add(Json &root, const std::vector<std::string> &path, Json value) {
+    if (path.empty()) {
+        root = std::move(value);
+        return;
+    }
+    Json &parent = resolve(root, path, path.size() - 1);
+    if (parent.isObject()) {
+        parent[path.back()] = std::move(value);
+    } else if (parent.isArray()) {
+        parent.insert(
+            index_of(path.back(), parent.size().value(), true),
+            std::move(value));
+    } else {
+        throw std::logic_error("patch path failed !");
+    }
+}
+
+Json remove(Json &root, const std::vector<std::string> &path) {
+    if (path.empty()) { throw std::logic_error("patch path failed !"); }
+    Json &parent = resolve(root, path, path.size() - 1);
+    Json value;
+    if (parent.isObject()) {
+        auto it = parent.find(path.back());
+        if (it == parent.getObject()->end()) {
+            throw std::logic_error("patch path failed !");
+        }
+        value = std::move(it->second);
+        parent.erase(path.back());
+    } else if (parent.isArray()) {
+        const std::size_t index =
+            index_of(path.back(), parent.size().value(), false);
+        value = std::move(parent[index]);
+        parent.erase(index);
+    } else {
+        throw std::logic_error("patch path failed !");
+    }
+    return value;
+}
+
+//! Member name of op as a string.
+const std::string &member(Json &op, const char *name) {
+    auto it = op.find(name);
+    if (it == op.getObject()->end() || !it->second.isString()) {
+        throw std::logic_error(std::string("patch ") + name + " failed !");
+    }
+    return *it->second.getString();
+}
+
+} // namespace
+
+Json eee::diff(const Json &from, const Json &to) {
+    Sides sides;
+    hash_tree(from, sides.from);
+    hash_tree(to, sides.to);
+    std::vector<Json> ops;
+    std::string path;
+    diff_into(from, to, sides, path, ops);
+    return Json(std::move(ops));
+}
+
+void eee::applyPatch(Json &target, Json patch) {
+    if (!patch.isArray() || patch.getArray() == nullptr) {
+        throw std::logic_error("patch failed !");
+    }
+    for (std::size_t i = 0; i < patch.size().value(); i++) {
+        Json &op = patch[i];
+        if (!op.isObject()) { throw std::logic_error("patch failed !"); }
+        const std::string &name = member(op, "op");
+        const std::vector<std::string> path = tokens(member(op, "path"));
+        auto value = op.find("value");
+        const bool hasValue = value != op.getObject()->end();
+        if (name == "add" || name == "replace" || name == "test") {
+            if (!hasValue) { throw std::logic_error("patch value failed !"); }
+        }
+        if (name == "add") {
+            add(target, path, std::move(value->second));
+        } else if (name == "remove") {
+            remove(target, path);
+        } else if (name == "replace") {
+            resolve(target, path, path.size()) = std::move(value->second);
+        } else if (name == "test") {
+            if (resolve(target, path, path.size()) != value->second) {
+                throw std::logic_error("patch test failed !");
+            }
+        } else if (name == "move" || name == "copy") {
+            const std::string &text = member(op, "from");
+            const std::vector<std::string> from = tokens(text);
+            if (name == "copy") {
+                add(target, path, resolve(target, from, from.size()));
+                continue;
+            }
+            if (from == path) {
+                resolve(target, from, from.size());
+                continue;
+            }
+            // A value cannot be moved into itself.
+            if (from.size() < path.size()
+                && std::equal(from.begin(), from.end(), path.begin())) {
+                throw std::logic_error("patch from failed !");
+            }
+            add(target, path, remove(target, from));
+        } else {
+            throw std::logic_error("patch op failed !");
+        }
+    }
+}
+
+void eee::applyMergePatch(Json &target, Json patch) {
+    if (!patch.isObject()) {
+        target = std::move(patch);
+        return;
+    }
+    if (!target.isObject()) { target = Json(Type::JSON_OBJECT); }
+    for (const auto &member : *patch.getObject()) {
+        Json &value = patch[member.first];
+        if (value.isNull()) {
+            target.erase(member.first);
+        } else {
+            applyMergePatch(target[member.first], std::move(value));
+        }
+    }
+}
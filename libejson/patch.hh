@@ -0,0 +1,34 @@
+#pragma once
+
+#include "json.hh"
+
+namespace eee {
+
+//! \brief Operations turning from into to, as a JSON Patch (RFC 6902) array
+//! of add, remove and replace operations.
+//!
+//! Both trees are hashed once up front. A subtree whose hash differs from
+//! its counterpart's is descended into without being compared, and one
+//! whose hash matches is confirmed equal with a single == and skipped, so
+//! the diff takes time linear in the size of the documents rather than in
+//! size times depth. Arrays are matched
+//! by their common prefix and suffix; the elements between them are diffed
+//! pairwise and the surplus is removed or added.
+Json diff(const Json &from, const Json &to);
+
+//! \brief Apply a JSON Patch (RFC 6902) to target in place. Values of add
+//! and replace are moved out of patch, and move operations relink the
+//! subtree without copying it, so pass the patch as an rvalue when it is
+//! not needed afterwards.
+//! \throw std::logic_error if the patch is malformed, a path does not
+//! exist or a test fails. Operations before the failing one stay applied;
+//! patch a copy when the update must be all or nothing.
+void applyPatch(Json &target, Json patch);
+
+//! \brief Apply a JSON Merge Patch (RFC 7386) to target in place: members
+//! of an object patch replace or, when null, remove members of target,
+//! recursively; any other patch replaces target. Values are moved out of
+//! patch.
+void applyMergePatch(Json &target, Json patch);
+
+} // namespace eee
@@ -0,0 +1,206 @@
+#include "pushparser.hh"
+#include "tokenizer.hh"
+#include <stdexcept>
+#include <utility>
+
+using namespace eee;
+
+namespace {
+
+bool is_whitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+//! Characters of numbers and of true, false and null; the Tokenizer
+//! checks their grammar once the token is complete.
+bool is_scalar(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-'
+           || c == '+' || c == '.' || c == 'E';
+}
+
+} // namespace
+
+PushParser::PushParser(bool strictUtf8)
+    : _stack(), _state(State::VALUE), _token(Token::NONE), _text()
+    , _escape(false), _tokenStart(0), _offset(0), _root(), _strict(strictUtf8) {
+}
+
+void PushParser::fail(const char *what, std::size_t offset) const {
+    throw std::logic_error(
+        std::string(what) + " (offset " + std::to_string(offset) + ")");
+}
+
+void PushParser::reset() {
+    _stack.clear();
+    _state = State::VALUE;
+    _token = Token::NONE;
+    _text.clear();
+    _escape = false;
+    _offset = 0;
+    _root = nullptr;
+}
+
+bool PushParser::done() const {
+    return _state == State::DONE;
+}
+
+void PushParser::feed(std::string_view chunk) {
+    const std::size_t n = chunk.size();
+    std::size_t i = 0;
+    while (i < n) {
+        if (_token == Token::STRING) {
+            const std::size_t begin = i;
+            bool closed = false;
+            for (; i < n && !closed; i++) {
+                const char c = chunk[i];
+                if (_escape) {
+                    _escape = false;
+                } else if (c == '\\') {
+                    _escape = true;
+                } else if (c == '"') {
+                    closed = true;
+                }
+            }
+            _text.append(chunk.data() + begin, i - begin);
+            if (closed) { finish_token(); }
+            continue;
+        }
+        if (_token == Token::NUMBER) {
+            const std::size_t begin = i;
+            while (i < n && is_scalar(chunk[i])) { i++; }
+            _text.append(chunk.data() + begin, i - begin);
+            // The token may go on in the next chunk.
+            if (i < n) { finish_token(); }
+            continue;
+        }
+
+        const char c = chunk[i];
+        if (is_whitespace(c)) {
+            i++;
+            continue;
+        }
+        const std::size_t at = _offset + i;
+        switch (_state) {
+            case State::VALUE_OR_CLOSE:
+                if (c == ']') {
+                    close(c, at);
+                    i++;
+                    break;
+                }
+                [[fallthrough]];
+            case State::VALUE:
+                if (c == '[' || c == '{') {
+                    _stack.push_back(Frame{c == '{', {}, {}, {}});
+                    _state = c == '{' ? State::KEY_OR_CLOSE
+                                      : State::VALUE_OR_CLOSE;
+                    i++;
+                } else if (c == '"') {
+                    _token = Token::STRING;
+                    _tokenStart = at;
+                    _text.push_back(c);
+                    i++;
+                } else if (is_scalar(c)) {
+                    _token = Token::NUMBER;
+                    _tokenStart = at;
+                } else {
+                    fail("value failed !", at);
+                }
+                break;
+            case State::KEY_OR_CLOSE:
+                if (c == '}') {
+                    close(c, at);
+                    i++;
+                    break;
+                }
+                [[fallthrough]];
+            case State::KEY:
+                if (c != '"') { fail("key failed !", at); }
+                _token = Token::STRING;
+                _tokenStart = at;
+                _text.push_back(c);
+                i++;
+                break;
+            case State::COLON:
+                if (c != ':') { fail(": failed (object) !", at); }
+                _state = State::VALUE;
+                i++;
+                break;
+            case State::COMMA_OR_CLOSE:
+                if (c == ',') {
+                    _state = _stack.back().object ? State::KEY : State::VALUE;
+                } else {
+                    close(c, at);
+                }
+                i++;
+                break;
+            case State::DONE:
+                fail("parse is failed ! ", at);
+        }
+    }
+    _offset += n;
+}
+
+void PushParser::finish_token() {
+    Tokenizer tokens(_text, _strict);
+    try {
+        if (_token == Token::STRING) {
+            std::string_view value = tokens.readString();
+            _token = Token::NONE;
+            if (_state == State::KEY || _state == State::KEY_OR_CLOSE) {
+                _stack.back().key.assign(value);
+                _state = State::COLON;
+            } else {
+                deliver(Json(std::string(value)));
+            }
+        } else {
+            Json value = tokens.readValue();
+            if (!tokens.done()) { throw std::logic_error("value failed !"); }
+            _token = Token::NONE;
+            deliver(std::move(value));
+        }
+    } catch (const std::logic_error &e) {
+        // The Tokenizer only knows offsets within the token.
+        _token = Token::NONE;
+        throw std::logic_error(
+            std::string(e.what()) + " in token at offset "
+            + std::to_string(_tokenStart));
+    }
+    _text.clear();
+}
+
+void PushParser::deliver(Json value) {
+    if (_stack.empty()) {
+        _root = std::move(value);
+        _state = State::DONE;
+        return;
+    }
+    Frame &frame = _stack.back();
+    if (frame.object) {
+        // Later members win, as in Parser.
+        frame.members[frame.key] = std::move(value);
+    } else {
+        frame.items.emplace_back(std::move(value));
+    }
+    _state = State::COMMA_OR_CLOSE;
+}
+
+void PushParser::close(char c, std::size_t offset) {
+    Frame &frame = _stack.back();
+    if (c != (frame.object ? '}' : ']')) {
+        fail(frame.object ? "object parse failed !" : "array parse failed !",
+             offset);
+    }
+    Json value = frame.object ? Json(std::move(frame.members))
+                              : Json(std::move(frame.items));
+    _stack.pop_back();
+    deliver(std::move(value));
+}
+
+Json PushParser::finish() {
+    if (_token == Token::STRING) { fail("string end failed ! ", _offset); }
+    if (_token == Token::NUMBER) { finish_token(); }
+    if (_state != State::DONE) { fail("parse is failed ! ", _offset); }
+    Json value = std::move(_root);
+    reset();
+    return value;
+}
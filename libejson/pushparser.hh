@@ -0,0 +1,86 @@
+#pragma once
+
+#include "json.hh"
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace eee {
+
+//! \brief A JSON parser fed one chunk of input at a time.
+//!
+//! Chunks may split the text anywhere, even inside a string or a number;
+//! the parser keeps its place between feed() calls and only buffers the
+//! token that is cut, so input can be parsed as it arrives instead of being
+//! collected first. Errors throw std::logic_error with the offset in the
+//! whole input.
+class PushParser {
+  private:
+    //! \brief What the next significant character may be
+    enum class State {
+        VALUE,
+        VALUE_OR_CLOSE,
+        KEY,
+        KEY_OR_CLOSE,
+        COLON,
+        COMMA_OR_CLOSE,
+        DONE
+    };
+    //! \brief Kind of the scalar token being read
+    enum class Token { NONE, STRING, NUMBER };
+    //! \brief An array or object being built
+    struct Frame {
+        bool object;
+        std::vector<Json> items;
+        std::map<std::string, Json> members;
+        //! \brief Key of the member being read
+        std::string key;
+    };
+
+    //! \brief Open containers, innermost last
+    std::vector<Frame> _stack;
+    State _state;
+    Token _token;
+    //! \brief Bytes of the current token, which may span chunks
+    std::string _text;
+    //! \brief The last byte of _text is a backslash inside a string
+    bool _escape;
+    //! \brief Input offset where the current token started
+    std::size_t _tokenStart;
+    //! \brief Input offset of the current chunk
+    std::size_t _offset;
+    //! \brief The finished top-level value
+    Json _root;
+    //! \brief Reject strings that are not well-formed UTF-8
+    bool _strict;
+
+    //! \brief Throw a std::logic_error mentioning the input offset
+    [[noreturn]] void fail(const char *what, std::size_t offset) const;
+    //! \brief Decode the complete token in _text and deliver it
+    void finish_token();
+    //! \brief Add a complete value to the innermost container or the root
+    void deliver(Json value);
+    //! \brief Close the innermost container with bracket c
+    void close(char c, std::size_t offset);
+
+  public:
+    //! \param strictUtf8 'true' to reject strings that are not well-formed
+    //! UTF-8
+    explicit PushParser(bool strictUtf8 = false);
+
+    //! \brief Parse the next chunk of input. Nothing of chunk is referenced
+    //! after the call returns.
+    void feed(std::string_view chunk);
+    //! \brief End of input.
+    //! \return The parsed value. The parser is reset for the next document.
+    Json finish();
+    //! \return 'true' if a complete top-level value has been read. A number
+    //! at the very end of the input only completes in finish().
+    bool done() const;
+    //! \brief Drop partial input and start over.
+    void reset();
+};
+
+} // namespace eee
@@ -0,0 +1,128 @@
+#include "shareddocument.hh"
+#include "parserpool.hh"
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+using namespace eee;
+
+SharedDocument::Reader::Reader(
+    const SharedDocument *doc, std::size_t slot, const Json *json)
+    : _doc(doc), _slot(slot), _json(json) {
+}
+
+SharedDocument::Reader::Reader(Reader &&other) noexcept
+    : _doc(other._doc), _slot(other._slot), _json(other._json) {
+    other._doc = nullptr;
+}
+
+SharedDocument::Reader::~Reader() {
+    if (_doc == nullptr) { return; }
+    Slot &slot = _doc->_slots[_slot];
+    slot.epoch.store(0, std::memory_order_release);
+    slot.busy.store(false, std::memory_order_release);
+}
+
+const Json &SharedDocument::Reader::operator*() const {
+    return *_json;
+}
+
+const Json *SharedDocument::Reader::operator->() const {
+    return _json;
+}
+
+SharedDocument::SharedDocument() : SharedDocument(Json()) {
+}
+
+SharedDocument::SharedDocument(Json json)
+    : _current(nullptr), _epoch(1), _retired(), _writer(), _pending(0)
+    , _pendingMutex(), _idle() {
+    json.disableCache();
+    _current.store(new Json(std::move(json)));
+}
+
+SharedDocument::~SharedDocument() {
+    std::unique_lock<std::mutex> lock(_pendingMutex);
+    _idle.wait(lock, [this]() { return _pending == 0; });
+    delete _current.load();
+}
+
+SharedDocument::Reader SharedDocument::read() const {
+    // Threads tend to get the same slot back, which keeps it in their cache.
+    thread_local std::size_t hint = std::hash<std::thread::id>()(
+        std::this_thread::get_id());
+    std::size_t i = hint % kReaderSlots;
+    for (;; i = (i + 1) % kReaderSlots) {
+        bool expected = false;
+        if (!_slots[i].busy.load(std::memory_order_relaxed)
+            && _slots[i].busy.compare_exchange_strong(
+                expected, true, std::memory_order_acquire)) {
+            break;
+        }
+    }
+    hint = i;
+    // The epoch is announced before the pointer is loaded: a writer that
+    // does not see the announcement has already swapped the pointer.
+    _slots[i].epoch.store(_epoch.load());
+    return Reader(this, i, _current.load());
+}
+
+void SharedDocument::publish(Json json) {
+    // Const calls fill caches, which concurrent readers must not do.
+    json.disableCache();
+    auto next = std::make_unique<const Json>(std::move(json));
+    std::lock_guard<std::mutex> lock(_writer);
+    const Json *old = _current.exchange(next.release());
+    _retired.push_back({std::unique_ptr<const Json>(old), _epoch.load()});
+    _epoch.fetch_add(1);
+    reclaim();
+}
+
+void SharedDocument::reclaim() {
+    // A reader that announced epoch e may hold any document retired in e or
+    // later.
+    std::uint64_t oldest = _epoch.load();
+    for (const Slot &slot : _slots) {
+        std::uint64_t epoch = slot.epoch.load();
+        if (epoch != 0 && epoch < oldest) { oldest = epoch; }
+    }
+    _retired.erase(
+        std::remove_if(
+            _retired.begin(),
+            _retired.end(),
+            [oldest](const Retired &r) { return r.epoch < oldest; }),
+        _retired.end());
+}
+
+void SharedDocument::reload(const std::string &text) {
+    publish(ParserPool::local().parse(text));
+}
+
+void SharedDocument::reloadAsync(
+    std::string text, std::function<void(std::exception_ptr)> done) {
+    {
+        std::lock_guard<std::mutex> lock(_pendingMutex);
+        _pending++;
+    }
+    // Detached, so the caller never waits for the parse; the destructor
+    // waits for _pending instead.
+    std::thread([this, text = std::move(text), done = std::move(done)]() {
+        std::exception_ptr error;
+        try {
+            reload(text);
+        } catch (...) { error = std::current_exception(); }
+        if (done) { done(error); }
+        std::lock_guard<std::mutex> lock(_pendingMutex);
+        if (--_pending == 0) { _idle.notify_all(); }
+    }).detach();
+}
+
+std::uint64_t SharedDocument::version() const {
+    return _epoch.load() - 1;
+}
+
+std::size_t SharedDocument::retired() {
+    std::lock_guard<std::mutex> lock(_writer);
+    reclaim();
+    return _retired.size();
+}
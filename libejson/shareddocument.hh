@@ -0,0 +1,115 @@
+#pragma once
+
+#include "json.hh"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace eee {
+
+//! \brief A Json shared by many reader threads and replaced as a whole.
+//!
+//! Each published document is immutable and reached through an atomic
+//! pointer. A reader announces the epoch it started in, loads the pointer and
+//! keeps the document alive until its Reader is destroyed; it never takes a
+//! lock or waits for a writer. publish() swaps in the new document and frees
+//! the old ones once every reader that could still see them has finished, so
+//! readers always see one consistent document, old or new. Published
+//! documents have their caches dropped (see Json::enableCache()), so that
+//! reading them never writes.
+class SharedDocument {
+  public:
+    //! \brief Concurrent readers served without waiting. More readers spin
+    //! until a slot frees up.
+    static constexpr std::size_t kReaderSlots = 64;
+
+    //! \brief Read access to the document current when it was created
+    class Reader {
+      private:
+        const SharedDocument *_doc;
+        std::size_t _slot;
+        const Json *_json;
+
+      public:
+        Reader(const SharedDocument *doc, std::size_t slot, const Json *json);
+        Reader(Reader &&other) noexcept;
+        Reader(const Reader &other) = delete;
+        Reader &operator=(const Reader &other) = delete;
+        Reader &operator=(Reader &&other) = delete;
+        //! \brief Leave the epoch, the document may be freed afterwards.
+        ~Reader();
+
+        const Json &operator*() const;
+        const Json *operator->() const;
+    };
+
+  private:
+    //! \brief Epoch a reader entered in, 0 while the slot is unused
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> epoch{0};
+        std::atomic<bool> busy{false};
+    };
+    //! \brief A replaced document and the epoch it was replaced in
+    struct Retired {
+        std::unique_ptr<const Json> json;
+        std::uint64_t epoch;
+    };
+
+    //! \brief The current document
+    std::atomic<const Json *> _current;
+    //! \brief Incremented by every publish(), starts at 1
+    std::atomic<std::uint64_t> _epoch;
+    //! \brief Announced epochs of the active readers
+    mutable Slot _slots[kReaderSlots];
+    //! \brief Replaced documents not freed yet
+    std::vector<Retired> _retired;
+    //! \brief Serializes writers
+    std::mutex _writer;
+    //! \brief reloadAsync() threads still running, guarded by _pendingMutex
+    std::size_t _pending;
+    std::mutex _pendingMutex;
+    //! \brief Signalled when _pending drops to 0
+    std::condition_variable _idle;
+
+    //! \brief Free the retired documents no reader can still see.
+    void reclaim();
+
+  public:
+    //! \brief Start with a null document
+    SharedDocument();
+    //! \brief Start with json
+    explicit SharedDocument(Json json);
+    SharedDocument(const SharedDocument &other) = delete;
+    SharedDocument &operator=(const SharedDocument &other) = delete;
+    //! \brief All readers must have finished before destruction. Waits for
+    //! the reloadAsync() calls still running.
+    ~SharedDocument();
+
+    //! \brief Pin the current document for reading
+    Reader read() const;
+    //! \brief Make json the current document. Readers that started before
+    //! keep the old one until they finish.
+    void publish(Json json);
+    //! \brief Parse text on the calling thread, then publish it. On a parse
+    //! error the current document is kept and the error is thrown.
+    void reload(const std::string &text);
+    //! \brief reload() on a detached thread, returning at once. done, if
+    //! set, is then called on that thread with nullptr once the document is
+    //! published, or with the error that kept it from being published.
+    void reloadAsync(
+        std::string text,
+        std::function<void(std::exception_ptr)> done = nullptr);
+    //! \brief Number of documents published so far
+    std::uint64_t version() const;
+    //! \brief Number of replaced documents still waiting for readers
+    std::size_t retired();
+};
+
+} // namespace eee
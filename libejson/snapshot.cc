@@ -0,0 +1,380 @@
+#include "snapshot.hh"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace eee;
+
+namespace {
+
+constexpr char kMagic[4] = {'E', 'J', 'S', 'N'};
+constexpr std::uint32_t kVersion = 1;
+//! magic, version, root offset, reserved
+constexpr std::size_t kHeaderSize = 16;
+//! tag, count
+constexpr std::size_t kNodeSize = 8;
+
+void align(std::string &out) {
+    out.resize((out.size() + 7) & ~std::size_t{7}, '\0');
+}
+
+void put32(std::string &out, std::size_t at, std::uint32_t value) {
+    std::memcpy(&out[at], &value, sizeof(value));
+}
+
+void append32(std::string &out, std::uint32_t value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+std::uint32_t to32(std::size_t value) {
+    if (value > UINT32_MAX) { throw std::logic_error("snapshot too large !"); }
+    return static_cast<std::uint32_t>(value);
+}
+
+//! \brief Append a node header, reserving extra bytes after it.
+std::size_t begin_node(
+    std::string &out, Type type, std::size_t count, std::size_t extra = 0) {
+    align(out);
+    std::size_t node = out.size();
+    append32(out, static_cast<std::uint32_t>(type));
+    append32(out, to32(count));
+    out.resize(out.size() + extra, '\0');
+    return node;
+}
+
+std::size_t write_string(std::string &out, std::string_view value) {
+    std::size_t node = begin_node(out, Type::JSON_STRING, value.size());
+    out.append(value);
+    out.push_back('\0');
+    return node;
+}
+
+std::size_t write_node(std::string &out, const Json &json) {
+    switch (json.type()) {
+        case Type::JSON_NULL:
+            return begin_node(out, Type::JSON_NULL, 0);
+        case Type::JSON_BOOL:
+            return begin_node(out, Type::JSON_BOOL, *json.valueBool());
+        case Type::JSON_INT: {
+            std::size_t node = begin_node(out, Type::JSON_INT, 0, 8);
+            std::int64_t value = *json.valueInt();
+            std::memcpy(&out[node + kNodeSize], &value, sizeof(value));
+            return node;
+        }
+        case Type::JSON_DOUBLE: {
+            std::size_t node = begin_node(out, Type::JSON_DOUBLE, 0, 8);
+            double value = *json.valueDouble();
+            std::memcpy(&out[node + kNodeSize], &value, sizeof(value));
+            return node;
+        }
+        case Type::JSON_STRING:
+            return write_string(out, *json.getString());
+        case Type::JSON_ARRAY: {
+            const std::size_t n = json.size().value();
+            std::size_t node = begin_node(out, Type::JSON_ARRAY, n, 4 * n);
+            const auto *ints = json.getIntArray();
+            const auto *doubles = json.getDoubleArray();
+            for (std::size_t i = 0; i < n; i++) {
+                std::size_t child =
+                    ints      ? write_node(out, Json((*ints)[i]))
+                    : doubles ? write_node(out, Json((*doubles)[i]))
+                              : write_node(out, (*json.getArray())[i]);
+                put32(out, node + kNodeSize + 4 * i, to32(child - node));
+            }
+            return node;
+        }
+        case Type::JSON_OBJECT: {
+            const auto &obj = *json.getObject();
+            std::size_t node =
+                begin_node(out, Type::JSON_OBJECT, obj.size(), 8 * obj.size());
+            std::size_t i = 0;
+            // std::map iterates in key order, which is the order find() needs
+            for (const auto &[k, v] : obj) {
+                std::size_t key = write_string(out, k);
+                put32(out, node + kNodeSize + 8 * i, to32(key - node));
+                std::size_t value = write_node(out, v);
+                put32(out, node + kNodeSize + 8 * i + 4, to32(value - node));
+                i++;
+            }
+            return node;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+std::string eee::writeSnapshot(const Json &json) {
+    std::string out(kMagic, sizeof(kMagic));
+    append32(out, kVersion);
+    append32(out, kHeaderSize);
+    append32(out, 0);
+    write_node(out, json);
+    align(out);
+    return out;
+}
+
+void eee::writeSnapshot(const Json &json, const std::string &path) {
+    std::string bytes = writeSnapshot(json);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!file) { throw std::runtime_error("snapshot write failed: " + path); }
+}
+
+SnapshotView::SnapshotView(const char *begin, const char *end, const char *node)
+    : _begin(begin), _end(end), _node(node) {
+    if (node < begin || end - node < static_cast<std::ptrdiff_t>(kNodeSize)
+        || (node - begin) % 8 != 0 || word(0) > 6) {
+        throw std::logic_error("snapshot corrupt !");
+    }
+}
+
+SnapshotView SnapshotView::root(std::string_view bytes) {
+    if (bytes.size() < kHeaderSize
+        || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) {
+        throw std::logic_error("snapshot magic failed !");
+    }
+    std::uint32_t version, offset;
+    std::memcpy(&version, bytes.data() + 4, sizeof(version));
+    std::memcpy(&offset, bytes.data() + 8, sizeof(offset));
+    if (version != kVersion) {
+        throw std::logic_error("snapshot version failed !");
+    }
+    const char *begin = bytes.data();
+    if (offset > bytes.size()) { throw std::logic_error("snapshot corrupt !"); }
+    return SnapshotView(begin, begin + bytes.size(), begin + offset);
+}
+
+std::uint32_t SnapshotView::word(std::size_t offset) const {
+    if (static_cast<std::size_t>(_end - _node) < offset + 4) {
+        throw std::logic_error("snapshot corrupt !");
+    }
+    std::uint32_t value;
+    std::memcpy(&value, _node + offset, sizeof(value));
+    return value;
+}
+
+SnapshotView SnapshotView::child(std::size_t offset) const {
+    std::uint32_t rel = word(offset);
+    // Children always follow their parent, which also rules out cycles.
+    if (rel < kNodeSize || static_cast<std::size_t>(_end - _node) < rel) {
+        throw std::logic_error("snapshot corrupt !");
+    }
+    return SnapshotView(_begin, _end, _node + rel);
+}
+
+Type SnapshotView::type() const {
+    return static_cast<Type>(word(0));
+}
+
+bool SnapshotView::isNull() const {
+    return type() == Type::JSON_NULL;
+}
+
+bool SnapshotView::isBool() const {
+    return type() == Type::JSON_BOOL;
+}
+
+bool SnapshotView::isInt() const {
+    return type() == Type::JSON_INT;
+}
+
+bool SnapshotView::isDouble() const {
+    return type() == Type::JSON_DOUBLE;
+}
+
+bool SnapshotView::isString() const {
+    return type() == Type::JSON_STRING;
+}
+
+bool SnapshotView::isArray() const {
+    return type() == Type::JSON_ARRAY;
+}
+
+bool SnapshotView::isObject() const {
+    return type() == Type::JSON_OBJECT;
+}
+
+std::optional<bool> SnapshotView::valueBool() const {
+    if (isBool()) { return word(4) != 0; }
+    return std::nullopt;
+}
+
+std::optional<int> SnapshotView::valueInt() const {
+    if (!isInt()) { return std::nullopt; }
+    word(kNodeSize + 4);
+    std::int64_t value;
+    std::memcpy(&value, _node + kNodeSize, sizeof(value));
+    return static_cast<int>(value);
+}
+
+std::optional<double> SnapshotView::valueDouble() const {
+    if (!isDouble()) { return std::nullopt; }
+    word(kNodeSize + 4);
+    double value;
+    std::memcpy(&value, _node + kNodeSize, sizeof(value));
+    return value;
+}
+
+std::optional<std::string_view> SnapshotView::valueString() const {
+    if (!isString()) { return std::nullopt; }
+    std::size_t size = word(4);
+    if (static_cast<std::size_t>(_end - _node) < kNodeSize + size + 1) {
+        throw std::logic_error("snapshot corrupt !");
+    }
+    return std::string_view(_node + kNodeSize, size);
+}
+
+std::optional<std::size_t> SnapshotView::size() const {
+    switch (type()) {
+        case Type::JSON_STRING:
+        case Type::JSON_ARRAY:
+        case Type::JSON_OBJECT:
+            return word(4);
+        default:
+            return std::nullopt;
+    }
+}
+
+SnapshotView SnapshotView::operator[](std::size_t index) const {
+    if (!isArray() || index >= word(4)) {
+        throw std::out_of_range("snapshot index out of range");
+    }
+    return child(kNodeSize + 4 * index);
+}
+
+SnapshotView SnapshotView::operator[](std::string_view key) const {
+    auto ret = find(key);
+    if (!ret) { throw std::out_of_range("snapshot key not found"); }
+    return *ret;
+}
+
+std::optional<SnapshotView> SnapshotView::find(std::string_view key) const {
+    if (!isObject()) { return std::nullopt; }
+    std::size_t lo = 0, hi = word(4);
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        int cmp = keyAt(mid).compare(key);
+        if (cmp == 0) { return child(kNodeSize + 8 * mid + 4); }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view SnapshotView::keyAt(std::size_t index) const {
+    if (!isObject() || index >= word(4)) {
+        throw std::out_of_range("snapshot index out of range");
+    }
+    auto key = child(kNodeSize + 8 * index).valueString();
+    if (!key) { throw std::logic_error("snapshot corrupt !"); }
+    return *key;
+}
+
+SnapshotView SnapshotView::valueAt(std::size_t index) const {
+    if (!isObject() || index >= word(4)) {
+        throw std::out_of_range("snapshot index out of range");
+    }
+    return child(kNodeSize + 8 * index + 4);
+}
+
+Json SnapshotView::toJson() const {
+    switch (type()) {
+        case Type::JSON_NULL:
+            return Json();
+        case Type::JSON_BOOL:
+            return Json(*valueBool());
+        case Type::JSON_INT:
+            return Json(*valueInt());
+        case Type::JSON_DOUBLE:
+            return Json(*valueDouble());
+        case Type::JSON_STRING:
+            return Json(std::string(*valueString()));
+        case Type::JSON_ARRAY: {
+            std::vector<Json> data;
+            std::size_t n = word(4);
+            data.reserve(n);
+            for (std::size_t i = 0; i < n; i++) {
+                data.emplace_back((*this)[i].toJson());
+            }
+            return Json(std::move(data));
+        }
+        case Type::JSON_OBJECT: {
+            std::map<std::string, Json> data;
+            std::size_t n = word(4);
+            for (std::size_t i = 0; i < n; i++) {
+                data.emplace_hint(
+                    data.end(), std::string(keyAt(i)), valueAt(i).toJson());
+            }
+            return Json(std::move(data));
+        }
+    }
+    return Json();
+}
+
+Snapshot::Snapshot() : _bytes(), _map(nullptr), _mapSize(0) {
+}
+
+Snapshot::Snapshot(std::string bytes)
+    : _bytes(std::move(bytes)), _map(nullptr), _mapSize(0) {
+    SnapshotView::root(_bytes);
+}
+
+Snapshot::Snapshot(Snapshot &&other) noexcept
+    : _bytes(std::move(other._bytes)), _map(other._map)
+    , _mapSize(other._mapSize) {
+    other._map = nullptr;
+    other._mapSize = 0;
+}
+
+Snapshot &Snapshot::operator=(Snapshot &&other) noexcept {
+    std::swap(_bytes, other._bytes);
+    std::swap(_map, other._map);
+    std::swap(_mapSize, other._mapSize);
+    return *this;
+}
+
+Snapshot::~Snapshot() {
+    if (_map != nullptr) { ::munmap(_map, _mapSize); }
+}
+
+Snapshot Snapshot::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) { throw std::runtime_error("snapshot open failed: " + path); }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("snapshot open failed: " + path);
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("snapshot mmap failed: " + path);
+    }
+    Snapshot ret;
+    ret._map = map;
+    ret._mapSize = size;
+    SnapshotView::root(ret.bytes());
+    return ret;
+}
+
+std::string_view Snapshot::bytes() const {
+    if (_map != nullptr) {
+        return std::string_view(static_cast<const char *>(_map), _mapSize);
+    }
+    return _bytes;
+}
+
+SnapshotView Snapshot::root() const {
+    return SnapshotView::root(bytes());
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "json.hh"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace eee {
+
+//! \brief Read-only view of one value inside a binary snapshot.
+//!
+//! A snapshot is a flat, position independent encoding of a Json tree that
+//! is queried in place: every node starts on an 8-byte boundary with a
+//! {tag, count} header, containers refer to their children through offsets
+//! relative to the node, objects keep their keys sorted so lookups are a
+//! binary search, and numbers are stored aligned. Every access is bounds
+//! checked against the snapshot, so corrupt files throw instead of reading
+//! out of range.
+class SnapshotView {
+  private:
+    //! \brief First byte of the snapshot
+    const char *_begin;
+    //! \brief One past the last byte of the snapshot
+    const char *_end;
+    //! \brief Header of this node
+    const char *_node;
+
+    SnapshotView(const char *begin, const char *end, const char *node);
+
+    //! \brief Read the 32-bit word at offset from this node
+    std::uint32_t word(std::size_t offset) const;
+    //! \brief Resolve the relative offset stored at offset from this node
+    SnapshotView child(std::size_t offset) const;
+
+  public:
+    //! \brief Parse the header of a snapshot and view its root value.
+    //! \param bytes The complete snapshot, it must outlive the view
+    static SnapshotView root(std::string_view bytes);
+
+    //! \brief  Get the Type of the value.
+    Type type() const;
+    bool isNull() const;
+    bool isBool() const;
+    bool isInt() const;
+    bool isDouble() const;
+    bool isString() const;
+    bool isArray() const;
+    bool isObject() const;
+
+    //! \return 'nullopt' if the type is not Type::JSON_BOOL
+    std::optional<bool> valueBool() const;
+    //! \return 'nullopt' if the type is not Type::JSON_INT
+    std::optional<int> valueInt() const;
+    //! \return 'nullopt' if the type is not Type::JSON_DOUBLE
+    std::optional<double> valueDouble() const;
+    //! \return 'nullopt' if the type is not Type::JSON_STRING. The view points
+    //! into the snapshot and is NUL terminated.
+    std::optional<std::string_view> valueString() const;
+    //! \brief Get size of String, Array or Object
+    //! \return 'nullopt' for other types
+    std::optional<std::size_t> size() const;
+
+    //! \brief Element of an array
+    //! \throw std::out_of_range if index is out of range
+    SnapshotView operator[](std::size_t index) const;
+    //! \brief Member of an object
+    //! \throw std::out_of_range if the key does not exist
+    SnapshotView operator[](std::string_view key) const;
+    //! \brief Member of an object, by binary search over the sorted keys
+    //! \return 'nullopt' if the key does not exist or this is not an object
+    std::optional<SnapshotView> find(std::string_view key) const;
+    //! \brief Key of the index-th member of an object, in sorted order
+    std::string_view keyAt(std::size_t index) const;
+    //! \brief Value of the index-th member of an object, in sorted order
+    SnapshotView valueAt(std::size_t index) const;
+
+    //! \brief Copy the value into a Json
+    Json toJson() const;
+};
+
+//! \brief A snapshot held in memory or mapped from a file.
+class Snapshot {
+  private:
+    //! \brief Owned bytes when not mapped
+    std::string _bytes;
+    //! \brief Mapped file, or nullptr
+    void *_map;
+    //! \brief Length of the mapping
+    std::size_t _mapSize;
+
+    Snapshot();
+
+  public:
+    //! \brief Take ownership of snapshot bytes produced by writeSnapshot().
+    explicit Snapshot(std::string bytes);
+    Snapshot(const Snapshot &other) = delete;
+    Snapshot(Snapshot &&other) noexcept;
+    Snapshot &operator=(const Snapshot &other) = delete;
+    Snapshot &operator=(Snapshot &&other) noexcept;
+    ~Snapshot();
+
+    //! \brief Map a snapshot file read-only. Nothing is parsed; pages are
+    //! faulted in as values are visited.
+    static Snapshot open(const std::string &path);
+
+    //! \brief The raw snapshot bytes
+    std::string_view bytes() const;
+    //! \brief View the root value
+    SnapshotView root() const;
+};
+
+//! \brief Encode a Json tree as a snapshot.
+std::string writeSnapshot(const Json &json);
+//! \brief Encode a Json tree as a snapshot and write it to path.
+void writeSnapshot(const Json &json, const std::string &path);
+
+} // namespace eee
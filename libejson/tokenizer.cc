@@ -0,0 +1,258 @@
+#include "tokenizer.hh"
+#include "utf8.hh"
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+using namespace eee;
+
+namespace {
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+} // namespace
+
+Tokenizer::Tokenizer(std::string_view data, bool strictUtf8)
+    : _view(data), _pos(0), _strict(strictUtf8) {
+}
+
+void Tokenizer::fail(const char *what) const {
+    throw std::logic_error(
+        std::string(what) + " (offset " + std::to_string(_pos) + ")");
+}
+
+void Tokenizer::skipWhitespace() {
+    while (_pos < _view.size()
+           && (_view[_pos] == ' ' || _view[_pos] == '\n' || _view[_pos] == '\r'
+               || _view[_pos] == '\t')) {
+        _pos++;
+    }
+}
+
+char Tokenizer::peek() {
+    skipWhitespace();
+    return _pos < _view.size() ? _view[_pos] : '\0';
+}
+
+bool Tokenizer::consume(char c) {
+    if (peek() != c) { return false; }
+    _pos++;
+    return true;
+}
+
+void Tokenizer::expect(char c) {
+    if (!consume(c)) {
+        fail((std::string("expected '") + c + "' !").c_str());
+    }
+}
+
+std::string_view Tokenizer::readString() {
+    if (peek() != '"') { fail("value is not string !"); }
+    const std::size_t begin = ++_pos;
+    const std::size_t m = _view.size();
+    bool escaped = false;
+    while (_pos < m) {
+        std::size_t run = scanStringRun(_view.data() + _pos, m - _pos, _strict);
+        if (escaped) { _scratch.append(_view.data() + _pos, run); }
+        _pos += run;
+        if (_pos >= m) { break; }
+        const char c = _view[_pos];
+        if (c == '"') {
+            // Without escapes the result views the input.
+            std::string_view ret = escaped
+                                       ? std::string_view(_scratch)
+                                       : _view.substr(begin, _pos - begin);
+            _pos++;
+            return ret;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) { fail("string failed !"); }
+        if (c != '\\') { fail("string UTF-8 failed !"); }
+        if (!escaped) {
+            _scratch.assign(_view.data() + begin, _pos - begin);
+            escaped = true;
+        }
+        _pos = decodeEscape(_view, _pos + 1, _scratch);
+        if (_pos == 0) { fail("string \\ failed !"); }
+    }
+    fail("string end failed !");
+}
+
+std::string_view Tokenizer::readNumber(bool *isDouble) {
+    skipWhitespace();
+    const std::size_t begin = _pos;
+    const std::size_t m = _view.size();
+    bool flag = false;
+    auto digits = [&]() {
+        if (_pos >= m || !is_digit(_view[_pos])) {
+            fail("value is not number !");
+        }
+        while (_pos < m && is_digit(_view[_pos])) { _pos++; }
+    };
+    if (_pos < m && _view[_pos] == '-') { _pos++; }
+    if (_pos < m && _view[_pos] == '0') {
+        _pos++;
+    } else {
+        digits();
+    }
+    if (_pos < m && _view[_pos] == '.') {
+        _pos++;
+        flag = true;
+        digits();
+    }
+    if (_pos < m && (_view[_pos] == 'e' || _view[_pos] == 'E')) {
+        _pos++;
+        if (_pos < m && (_view[_pos] == '+' || _view[_pos] == '-')) { _pos++; }
+        flag = true;
+        digits();
+    }
+    if (isDouble != nullptr) { *isDouble = flag; }
+    return _view.substr(begin, _pos - begin);
+}
+
+bool Tokenizer::readBool() {
+    skipWhitespace();
+    if (_view.compare(_pos, 4, "true") == 0) {
+        _pos += 4;
+        return true;
+    }
+    if (_view.compare(_pos, 5, "false") == 0) {
+        _pos += 5;
+        return false;
+    }
+    fail("value is not bool !");
+}
+
+void Tokenizer::readNull() {
+    skipWhitespace();
+    if (_view.compare(_pos, 4, "null") != 0) { fail("value is not NULL !"); }
+    _pos += 4;
+}
+
+Json Tokenizer::readValue() {
+    switch (peek()) {
+        case 'n':
+            readNull();
+            return Json();
+        case 't':
+        case 'f':
+            return Json(readBool());
+        case '"':
+            return Json(std::string(readString()));
+        case '[': {
+            _pos++;
+            std::vector<Json> data;
+            if (consume(']')) { return Json(std::move(data)); }
+            do { data.emplace_back(readValue()); } while (consume(','));
+            expect(']');
+            return Json(std::move(data));
+        }
+        case '{': {
+            _pos++;
+            std::map<std::string, Json> data;
+            if (consume('}')) { return Json(std::move(data)); }
+            do {
+                std::string key(readString());
+                expect(':');
+                data[key] = readValue();
+            } while (consume(','));
+            expect('}');
+            return Json(std::move(data));
+        }
+        default: {
+            bool isDouble = false;
+            std::string_view number = readNumber(&isDouble);
+            if (!isDouble) {
+                std::int64_t value = 0;
+                auto [ptr, ec] = std::from_chars(
+                    number.data(), number.data() + number.size(), value);
+                if (ec == std::errc()
+                    && value >= std::numeric_limits<int>::min()
+                    && value <= std::numeric_limits<int>::max()) {
+                    return Json(static_cast<int>(value));
+                }
+            }
+            return Json(toDouble(number));
+        }
+    }
+}
+
+void Tokenizer::skipValue() {
+    switch (peek()) {
+        case 'n':
+            readNull();
+            break;
+        case 't':
+        case 'f':
+            readBool();
+            break;
+        case '"':
+            readString();
+            break;
+        case '[':
+            _pos++;
+            if (consume(']')) { break; }
+            do { skipValue(); } while (consume(','));
+            expect(']');
+            break;
+        case '{':
+            _pos++;
+            if (consume('}')) { break; }
+            do {
+                readString();
+                expect(':');
+                skipValue();
+            } while (consume(','));
+            expect('}');
+            break;
+        default:
+            readNumber();
+    }
+}
+
+std::size_t Tokenizer::position() const {
+    return _pos;
+}
+
+void Tokenizer::seek(std::size_t offset) {
+    _pos = offset < _view.size() ? offset : _view.size();
+}
+
+bool Tokenizer::done() {
+    skipWhitespace();
+    return _pos == _view.size();
+}
+
+double Tokenizer::toDouble(std::string_view number) {
+    // strtod needs a terminated buffer; numbers are short.
+    char buf[64];
+    std::string big;
+    const char *text = buf;
+    if (number.size() < sizeof(buf)) {
+        number.copy(buf, number.size());
+        buf[number.size()] = '\0';
+    } else {
+        big.assign(number);
+        text = big.c_str();
+    }
+    errno = 0;
+    double value = std::strtod(text, nullptr);
+    if (errno == ERANGE && (value == HUGE_VAL || value == -HUGE_VAL)) {
+        throw std::logic_error("value is not number !");
+    }
+    return value;
+}
+
+std::int64_t Tokenizer::toInt(std::string_view number) {
+    std::int64_t value = 0;
+    auto [ptr, ec] =
+        std::from_chars(number.data(), number.data() + number.size(), value);
+    if (ec != std::errc() || ptr != number.data() + number.size()) {
+        throw std::logic_error("value is not integer !");
+    }
+    return value;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "json.hh"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace eee {
+
+//! \brief A pull-style JSON lexer over a text buffer.
+//!
+//! Unlike Parser it builds no Json: callers walk the input one token at a
+//! time and skip what they do not need. Every read first skips white space.
+//! Errors throw std::logic_error like the Parser does.
+class Tokenizer {
+  private:
+    //! \brief The JSON text
+    std::string_view _view;
+    //! \brief Offset of the next unread character
+    std::size_t _pos;
+    //! \brief Decoded strings that contained escapes
+    std::string _scratch;
+    //! \brief Reject strings that are not well-formed UTF-8
+    bool _strict;
+
+    //! \brief Throw a std::logic_error mentioning the current offset
+    [[noreturn]] void fail(const char *what) const;
+
+  public:
+    //! \brief Construct a Tokenizer over data, which must outlive it.
+    //! \param strictUtf8 'true' to reject strings that are not well-formed
+    //! UTF-8
+    explicit Tokenizer(std::string_view data, bool strictUtf8 = false);
+
+    //! \brief Skip white space.
+    void skipWhitespace();
+    //! \brief Look at the next significant character.
+    //! \return '\0' at the end of input
+    char peek();
+    //! \brief Consume c if it is the next significant character.
+    //! \return 'true' if c was consumed
+    bool consume(char c);
+    //! \brief Consume c or throw.
+    void expect(char c);
+
+    //! \brief Read a string token.
+    //! \return The decoded string. It views the input when the string has no
+    //! escapes, and otherwise an internal buffer that the next read reuses.
+    std::string_view readString();
+    //! \brief Read a number token.
+    //! \param isDouble Set to 'true' if the number has a fraction or exponent
+    //! \return The text of the number
+    std::string_view readNumber(bool *isDouble = nullptr);
+    //! \brief Read true or false.
+    bool readBool();
+    //! \brief Read null.
+    void readNull();
+    //! \brief Read a complete value into a Json.
+    Json readValue();
+    //! \brief Skip a complete value without decoding it.
+    void skipValue();
+
+    //! \brief Offset of the next unread character.
+    std::size_t position() const;
+    //! \brief Continue reading at offset, e.g. one taken from position().
+    void seek(std::size_t offset);
+    //! \return 'true' if only white space is left.
+    bool done();
+
+    //! \brief Convert the text of a number to double.
+    static double toDouble(std::string_view number);
+    //! \brief Convert the text of an integer number to int64_t.
+    //! \throw std::logic_error if it does not fit
+    static std::int64_t toInt(std::string_view number);
+};
+
+} // namespace eee
@@ -0,0 +1,227 @@
+#include "utf8.hh"
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace eee;
+
+namespace {
+
+bool is_special(unsigned char c) {
+    return c == '"' || c == '\\' || c < 0x20;
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    return -1;
+}
+
+//! \return The value of the four hex digits at in[pos], or -1
+long hex4(std::string_view in, std::size_t pos) {
+    if (pos + 4 > in.size()) { return -1; }
+    long value = 0;
+    for (std::size_t i = pos; i < pos + 4; i++) {
+        int h = hex_value(in[i]);
+        if (h < 0) { return -1; }
+        value = (value << 4) | h;
+    }
+    return value;
+}
+
+//! Decode the \u escape whose 'u' is at in[pos], with the low half of a
+//! surrogate pair, and move pos past it.
+//! \return The code point, or -1 if the escape is malformed
+long read_u(std::string_view in, std::size_t &pos) {
+    long cp = hex4(in, pos + 1);
+    if (cp < 0 || (cp >= 0xdc00 && cp <= 0xdfff)) { return -1; }
+    pos += 5;
+    if (cp >= 0xd800 && cp <= 0xdbff) {
+        // High surrogate, a low one must follow.
+        if (pos + 1 >= in.size() || in[pos] != '\\' || in[pos + 1] != 'u') {
+            return -1;
+        }
+        long low = hex4(in, pos + 2);
+        if (low < 0xdc00 || low > 0xdfff) { return -1; }
+        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+        pos += 6;
+    }
+    return cp;
+}
+
+//! Validate a run of non-ASCII sequences starting at p[i].
+std::size_t skip_utf8(const char *p, std::size_t n, std::size_t i) {
+    while (i < n && static_cast<unsigned char>(p[i]) >= 0x80) {
+        std::size_t len = utf8Sequence(p + i, n - i);
+        if (len == 0) { break; }
+        i += len;
+    }
+    return i;
+}
+
+} // namespace
+
+std::size_t eee::scanStringRun(const char *p, std::size_t n, bool strict) {
+    std::size_t i = 0;
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    while (i + 16 <= n) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        // c <= 0x1f as unsigned: max(c, 0x1f) == 0x1f
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(
+                _mm_cmpeq_epi8(c, quote), _mm_cmpeq_epi8(c, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(c, control), control));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+        if (strict) {
+            // high bit set: non-ASCII, needs validation
+            mask |= static_cast<unsigned>(_mm_movemask_epi8(c));
+        }
+        if (mask == 0) {
+            i += 16;
+            continue;
+        }
+        i += static_cast<std::size_t>(__builtin_ctz(mask));
+        if (static_cast<unsigned char>(p[i]) < 0x80) { return i; }
+        std::size_t end = skip_utf8(p, n, i);
+        if (end == i) { return i; }
+        i = end;
+    }
+#endif
+    while (i < n) {
+        auto c = static_cast<unsigned char>(p[i]);
+        if (is_special(c)) { return i; }
+        if (c >= 0x80 && strict) {
+            std::size_t end = skip_utf8(p, n, i);
+            if (end == i) { return i; }
+            i = end;
+        } else {
+            i++;
+        }
+    }
+    return i;
+}
+
+std::size_t eee::utf8Sequence(const char *p, std::size_t n) {
+    if (n == 0) { return 0; }
+    auto c0 = static_cast<unsigned char>(p[0]);
+    if (c0 < 0x80) { return 1; }
+    std::size_t len;
+    // Bounds of the second byte, which rule out overlong forms, surrogates
+    // and code points above U+10FFFF.
+    unsigned char lo = 0x80, hi = 0xbf;
+    if (c0 >= 0xc2 && c0 <= 0xdf) {
+        len = 2;
+    } else if (c0 >= 0xe0 && c0 <= 0xef) {
+        len = 3;
+        if (c0 == 0xe0) { lo = 0xa0; }
+        if (c0 == 0xed) { hi = 0x9f; }
+    } else if (c0 >= 0xf0 && c0 <= 0xf4) {
+        len = 4;
+        if (c0 == 0xf0) { lo = 0x90; }
+        if (c0 == 0xf4) { hi = 0x8f; }
+    } else {
+        return 0;
+    }
+    if (n < len) { return 0; }
+    auto c1 = static_cast<unsigned char>(p[1]);
+    if (c1 < lo || c1 > hi) { return 0; }
+    for (std::size_t i = 2; i < len; i++) {
+        auto c = static_cast<unsigned char>(p[i]);
+        if (c < 0x80 || c > 0xbf) { return 0; }
+    }
+    return len;
+}
+
+bool eee::validUtf8(std::string_view s) {
+    std::size_t i = 0;
+    while (i < s.size()) {
+        // Quotes and controls are valid UTF-8, step over them.
+        i += scanStringRun(s.data() + i, s.size() - i, true);
+        if (i == s.size()) { break; }
+        if (static_cast<unsigned char>(s[i]) >= 0x80) { return false; }
+        i++;
+    }
+    return true;
+}
+
+void eee::appendUtf8(std::string &out, std::uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else {
+        out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+}
+
+std::size_t eee::decodeEscape(
+    std::string_view in, std::size_t pos, std::string &out) {
+    if (pos >= in.size()) { return 0; }
+    switch (in[pos]) {
+        case '"':
+            out.push_back('"');
+            return pos + 1;
+        case '\\':
+            out.push_back('\\');
+            return pos + 1;
+        case '/':
+            out.push_back('/');
+            return pos + 1;
+        case 'b':
+            out.push_back('\b');
+            return pos + 1;
+        case 'f':
+            out.push_back('\f');
+            return pos + 1;
+        case 'n':
+            out.push_back('\n');
+            return pos + 1;
+        case 'r':
+            out.push_back('\r');
+            return pos + 1;
+        case 't':
+            out.push_back('\t');
+            return pos + 1;
+        case 'u': {
+            long cp = read_u(in, pos);
+            if (cp < 0) { return 0; }
+            appendUtf8(out, static_cast<std::uint32_t>(cp));
+            return pos;
+        }
+        default:
+            return 0;
+    }
+}
+
+std::size_t eee::skipEscape(std::string_view in, std::size_t pos) {
+    if (pos >= in.size()) { return 0; }
+    switch (in[pos]) {
+        case '"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            return pos + 1;
+        case 'u':
+            return read_u(in, pos) < 0 ? 0 : pos;
+        default:
+            return 0;
+    }
+}
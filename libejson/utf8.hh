@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace eee {
+
+//! \brief Length of the run at the start of p that a JSON string scan can
+//! copy as is: no quote, backslash or control character. With SSE2 sixteen
+//! bytes are classified per step.
+//! \param strict also check that the run is well-formed UTF-8; the run then
+//! stops at the first invalid sequence
+std::size_t scanStringRun(const char *p, std::size_t n, bool strict);
+
+//! \brief Check the UTF-8 sequence at the start of p (RFC 3629: no overlong
+//! forms, surrogates or code points above U+10FFFF).
+//! \return Its length, or 0 if it is not well-formed
+std::size_t utf8Sequence(const char *p, std::size_t n);
+
+//! \brief Check that s is well-formed UTF-8.
+bool validUtf8(std::string_view s);
+
+//! \brief Append code point cp to out as UTF-8.
+void appendUtf8(std::string &out, std::uint32_t cp);
+
+//! \brief Decode the JSON escape whose letter is at in[pos] (just after the
+//! backslash) and append it to out. \uXXXX escapes are decoded to UTF-8,
+//! including surrogate pairs.
+//! \return The offset after the escape, or 0 if it is malformed
+std::size_t decodeEscape(
+    std::string_view in, std::size_t pos, std::string &out);
+
+//! \brief Check the JSON escape whose letter is at in[pos] like
+//! decodeEscape(), without decoding it.
+//! \return The offset after the escape, or 0 if it is malformed
+std::size_t skipEscape(std::string_view in, std::size_t pos);
+
+} // namespace eee
@@ -0,0 +1,233 @@
+#include "validate.hh"
+#include "utf8.hh"
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace eee;
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+//! Offset of the first non-white-space byte at or after p[i].
+std::size_t skip_whitespace(const char *p, std::size_t n, std::size_t i) {
+    // Most gaps between tokens are empty or a single space.
+    if (i >= n || !is_space(p[i])) { return i; }
+    i++;
+#ifdef __SSE2__
+    // Indentation of pretty-printed input comes in long runs.
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i ret = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+    for (; i + 16 <= n; i += 16) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        __m128i ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(c, space), _mm_cmpeq_epi8(c, newline)),
+            _mm_or_si128(_mm_cmpeq_epi8(c, ret), _mm_cmpeq_epi8(c, tab)));
+        auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(ws)) & 0xffffu;
+        if (mask != 0) {
+            return i + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+    }
+#endif
+    while (i < n && is_space(p[i])) { i++; }
+    return i;
+}
+
+//! Move i from the opening quote of a string past its closing quote.
+//! \return nullptr, or the error found at i
+const char *skip_string(std::string_view text, std::size_t &i, bool strict) {
+    const std::size_t n = text.size();
+    i++;
+    while (i < n) {
+        i += scanStringRun(text.data() + i, n - i, strict);
+        if (i >= n) { break; }
+        const char c = text[i];
+        if (c == '"') {
+            i++;
+            return nullptr;
+        }
+        if (c == '\\') {
+            std::size_t end = skipEscape(text, i + 1);
+            if (end == 0) { return "string \\ failed !"; }
+            i = end;
+            continue;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) { return "string failed !"; }
+        return "string UTF-8 failed !";
+    }
+    return "string end failed !";
+}
+
+//! Move i past the number starting at i.
+//! \return nullptr, or the error found at i
+const char *skip_number(std::string_view text, std::size_t &i) {
+    const std::size_t n = text.size();
+    auto digits = [&]() {
+        if (i >= n || !is_digit(text[i])) { return false; }
+        while (i < n && is_digit(text[i])) { i++; }
+        return true;
+    };
+    if (i < n && text[i] == '-') { i++; }
+    if (i < n && text[i] == '0') {
+        i++;
+    } else if (!digits()) {
+        return "value is not number !";
+    }
+    if (i < n && text[i] == '.') {
+        i++;
+        if (!digits()) { return "value is not number !"; }
+    }
+    if (i < n && (text[i] == 'e' || text[i] == 'E')) {
+        i++;
+        if (i < n && (text[i] == '+' || text[i] == '-')) { i++; }
+        if (!digits()) { return "value is not number !"; }
+    }
+    return nullptr;
+}
+
+//! The scan behind validate() and minify(). Containers are tracked in a bit
+//! stack instead of by recursion, so deep input cannot overflow the call
+//! stack and nothing is allocated.
+template <bool Minify>
+Validation scan(std::string_view text, std::string *out, bool strict) {
+    enum class Next { VALUE, KEY, AFTER };
+    const char *p = text.data();
+    const std::size_t n = text.size();
+    const std::size_t size = Minify ? out->size() : 0;
+    // One bit per open container, set for objects.
+    std::uint64_t stack[kMaxValidateDepth / 64];
+    std::size_t depth = 0, i = 0;
+    // Start of the text not yet copied to out.
+    std::size_t copy = 0;
+    const char *error = nullptr;
+    Next next = Next::VALUE;
+
+    auto whitespace = [&]() {
+        std::size_t end = skip_whitespace(p, n, i);
+        if (Minify && end != i) {
+            out->append(p + copy, i - copy);
+            copy = end;
+        }
+        i = end;
+    };
+    auto object = [&]() {
+        return (stack[(depth - 1) / 64] >> ((depth - 1) % 64) & 1) != 0;
+    };
+
+    while (error == nullptr) {
+        whitespace();
+        if (next == Next::KEY) {
+            if (i >= n || p[i] != '"') {
+                error = "key failed !";
+                break;
+            }
+            if ((error = skip_string(text, i, strict)) != nullptr) { break; }
+            whitespace();
+            if (i >= n || p[i] != ':') {
+                error = "expected ':' !";
+                break;
+            }
+            i++;
+            next = Next::VALUE;
+            continue;
+        }
+        if (next == Next::AFTER) {
+            if (depth == 0) {
+                if (i != n) { error = "parse is failed !"; }
+                break;
+            }
+            const char close = object() ? '}' : ']';
+            if (i < n && p[i] == ',') {
+                i++;
+                next = object() ? Next::KEY : Next::VALUE;
+            } else if (i < n && p[i] == close) {
+                i++;
+                depth--;
+            } else {
+                error = close == '}' ? "object failed !" : "array failed !";
+            }
+            continue;
+        }
+        if (i >= n) {
+            error = "value failed !";
+            break;
+        }
+        switch (p[i]) {
+            case '{':
+            case '[': {
+                if (depth == kMaxValidateDepth) {
+                    error = "nesting too deep !";
+                    break;
+                }
+                const std::uint64_t bit = std::uint64_t(1) << (depth % 64);
+                if (p[i] == '{') {
+                    stack[depth / 64] |= bit;
+                } else {
+                    stack[depth / 64] &= ~bit;
+                }
+                const char close = p[i] == '{' ? '}' : ']';
+                depth++;
+                i++;
+                whitespace();
+                if (i < n && p[i] == close) {
+                    i++;
+                    depth--;
+                    next = Next::AFTER;
+                } else {
+                    next = close == '}' ? Next::KEY : Next::VALUE;
+                }
+                break;
+            }
+            case '"':
+                error = skip_string(text, i, strict);
+                next = Next::AFTER;
+                break;
+            case 't':
+            case 'f':
+            case 'n': {
+                const char *word =
+                    p[i] == 't' ? "true" : p[i] == 'f' ? "false" : "null";
+                const std::size_t len = p[i] == 'f' ? 5 : 4;
+                if (text.compare(i, len, word) != 0) {
+                    error = "value failed !";
+                    break;
+                }
+                i += len;
+                next = Next::AFTER;
+                break;
+            }
+            default:
+                error = skip_number(text, i);
+                next = Next::AFTER;
+                break;
+        }
+    }
+    if (error != nullptr) {
+        if (Minify) { out->resize(size); }
+        return Validation{error, i};
+    }
+    if (Minify) { out->append(p + copy, i - copy); }
+    return Validation{};
+}
+
+} // namespace
+
+Validation eee::validate(std::string_view text, bool strictUtf8) {
+    return scan<false>(text, nullptr, strictUtf8);
+}
+
+Validation eee::minify(
+    std::string_view text, std::string &out, bool strictUtf8) {
+    return scan<true>(text, &out, strictUtf8);
+}
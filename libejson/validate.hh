@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace eee {
+
+//! \brief Outcome of validate() and minify(). Nothing is thrown, so callers
+//! rejecting bad input pay no exception cost.
+struct Validation {
+    //! \brief Description of the first error, nullptr if the text is valid
+    const char *error = nullptr;
+    //! \brief Offset of the byte at which the error was found
+    std::size_t offset = 0;
+
+    //! \return 'true' if the text is valid
+    explicit operator bool() const { return error == nullptr; }
+};
+
+//! \brief Nesting deeper than this is reported as an error by validate()
+//! and minify(), which keep their bracket stack in a fixed array.
+constexpr std::size_t kMaxValidateDepth = 4096;
+
+//! \brief Check that text is one well-formed JSON value, without building a
+//! Json or allocating. Strings are scanned with scanStringRun().
+//! Numbers are only checked for syntax, not for fitting a double.
+//! \param strictUtf8 'true' to also reject strings that are not well-formed
+//! UTF-8
+Validation validate(std::string_view text, bool strictUtf8 = false);
+
+//! \brief Append text to out with the white space between tokens removed,
+//! checking it as validate() does. Tokens are copied as they are, escapes
+//! included. On error out is left as it was.
+Validation minify(
+    std::string_view text, std::string &out, bool strictUtf8 = false);
+
+} // namespace eee
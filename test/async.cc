@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async.hh"
+#include "parser.hh"
+
+using namespace eee;
+
+static int tot_test = 0;
+static int acc_test = 0;
+
+#define EQUAL(expectly, actualy)                                 \
+    {                                                            \
+        tot_test++;                                              \
+        if (expectly == actualy) {                               \
+            acc_test++;                                          \
+        } else {                                                 \
+            std::fprintf(stderr, "%s:%d\n", __FILE__, __LINE__); \
+        }                                                        \
+    }
+
+void test_parse_async() {
+    Executor executor;
+    PipeSource pipe(executor);
+    Task<Json> task = parseAsync(pipe);
+    task.start();
+    // No data yet: the parser is suspended, not blocked.
+    EQUAL(false, task.done());
+
+    pipe.write("{\"a\" : [1, 2");
+    EQUAL((std::size_t)1, executor.run());
+    EQUAL(false, task.done());
+    pipe.write("], \"b\" : \"x");
+    pipe.write("y\"}");
+    pipe.close();
+    executor.run();
+    EQUAL(true, task.done());
+    EQUAL(std::string("{\"a\":[1,2],\"b\":\"xy\"}"), task.result().stringify());
+
+    // Errors surface from result().
+    PipeSource bad(executor);
+    Task<Json> failed = parseAsync(bad);
+    failed.start();
+    bad.write("[1, }");
+    bad.close();
+    executor.run();
+    bool thrown = false;
+    try {
+        failed.result();
+    } catch (std::logic_error &e) { thrown = true; }
+    EQUAL(true, thrown);
+}
+
+Task<std::size_t> count_members(PipeSource &pipe) {
+    Json json = co_await parseAsync(pipe);
+    co_return json.size().value();
+}
+
+void test_many_requests() {
+    // Many interleaved requests served by two threads.
+    const std::size_t n = 1000;
+    Executor executor;
+    std::vector<std::unique_ptr<PipeSource>> pipes;
+    std::vector<Task<std::size_t>> tasks;
+    for (std::size_t i = 0; i < n; i++) {
+        pipes.push_back(std::make_unique<PipeSource>(executor));
+        tasks.push_back(count_members(*pipes.back()));
+        tasks.back().start();
+    }
+    for (const char *chunk : {"[1,", "2,", "[3]", "]"}) {
+        for (auto &pipe : pipes) { pipe->write(chunk); }
+        std::thread other([&executor]() { executor.run(); });
+        executor.run();
+        other.join();
+    }
+    for (auto &pipe : pipes) { pipe->close(); }
+    executor.run();
+    std::size_t finished = 0;
+    for (auto &task : tasks) {
+        if (task.done() && task.result() == 3) { finished++; }
+    }
+    EQUAL(n, finished);
+}
+
+void test() {
+    test_parse_async();
+    test_many_requests();
+}
+
+int main() {
+    test();
+
+    printf(
+        "\n test result = %0.2f%% pass(%d/%d)\n",
+        (acc_test * 1.0) / tot_test * 100.0, acc_test, tot_test);
+    return 0;
+}
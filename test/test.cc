@@ -1,11 +1,36 @@
+#include <atomic>
 #include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 
+#include "arrayreader.hh"
+#include "bind.hh"
+#include "cbor.hh"
+#include "columns.hh"
+#include "escape.hh"
+#include "incremental.hh"
 #include "json.hh"
+#include "jsonpath.hh"
+#include "literal.hh"
+#include "msgpack.hh"
 #include "parser.hh"
+#include "parserpool.hh"
+#include "patch.hh"
+#include "pushparser.hh"
+#include "shareddocument.hh"
+#include "snapshot.hh"
+#include "utf8.hh"
+#include "validate.hh"
 
 using namespace eee;
 
@@ -227,10 +252,1213 @@ void test_parser() {
     std::cout << " b = " << b << "\n";
 }
 
+void test_parallel() {
+    std::string a = "[";
+    std::string o = "{";
+    for (int i = 0; i < 40000; i++) {
+        if (i != 0) {
+            a += ", ";
+            o += ",\n";
+        }
+        a += "{\"id\" : " + std::to_string(i)
+             + ", \"tag\" : \"a,b]}\", \"v\" : [1.5, null, true]}";
+        o += "\"k" + std::to_string(i % 30000) + "\" : [" + std::to_string(i)
+             + ", \"x\\\"{\"]";
+    }
+    a += "]";
+    o += "}";
+    Parser seq;
+    Parser par;
+    EQUAL(seq.parse(a), par.parseParallel(a, 4));
+    EQUAL(40000, par.parseParallel(a, 4).size());
+    EQUAL(seq.parse(o), par.parseParallel(o, 4));
+    EQUAL(30000, par.parseParallel(o, 4).size());
+
+    bool thrown = false;
+    try {
+        par.parseParallel(a.substr(0, a.size() - 1) + ",]", 4);
+    } catch (const std::logic_error &) { thrown = true; }
+    EQUAL(true, thrown);
+
+    // A key must be followed by ':', also in nested objects of workers.
+    const std::string nested =
+        o.substr(0, o.size() - 1) + ", \"z\" : {\"a\"x1}}";
+    for (const std::string &bad : {std::string("{\"a\" 1}"), nested}) {
+        thrown = false;
+        try {
+            par.parseParallel(bad, 4);
+        } catch (const std::logic_error &) { thrown = true; }
+        EQUAL(true, thrown);
+        thrown = false;
+        try {
+            seq.parse(bad);
+        } catch (const std::logic_error &) { thrown = true; }
+        EQUAL(true, thrown);
+    }
+}
+
+void test_binary() {
+    Parser p;
+    Json doc = p.parse(
+        "{\"a\" : [1, -1, 200, -200, 70000, -70000, 1.5, 0.1], "
+        "\"b\" : {\"c\" : null, \"d\" : true, \"e\" : false}, "
+        "\"s\" : \"0123456789012345678901234567890123456789\"}");
+    EQUAL(doc, fromMsgpack(toMsgpack(doc)));
+    EQUAL(doc, fromCbor(toCbor(doc)));
+    EQUAL(std::string("\x81\xa1\x61\x01", 4), toMsgpack(p.parse("{\"a\":1}")));
+    EQUAL(std::string("\x82\x01\x61\x61", 4), toCbor(p.parse("[1,\"a\"]")));
+
+    // indefinite-length CBOR array [_ 1, [2]] with a tagged element
+    Json indef = fromCbor(std::string("\x9f\x01\xc1\x81\x02\xff", 6));
+    EQUAL(p.parse("[1,[2]]"), indef);
+
+    std::string packed = toMsgpack(p.parse("[\"xy\"]"));
+    MsgpackReader reader(packed);
+    EQUAL(Type::JSON_ARRAY, reader.next().type);
+    std::string_view view = reader.next().string;
+    EQUAL(packed.data() + 2, view.data());
+    EQUAL(true, reader.done());
+
+    bool thrown = false;
+    try {
+        fromMsgpack(std::string("\xdd\xff\xff\xff\xff", 5));
+    } catch (const std::logic_error &) { thrown = true; }
+    EQUAL(true, thrown);
+
+    // hostile nesting is rejected, a long run of tags is skipped
+    thrown = false;
+    try {
+        fromMsgpack(std::string(100000, '\x91') + '\x01');
+    } catch (const std::logic_error &) { thrown = true; }
+    EQUAL(true, thrown);
+    thrown = false;
+    try {
+        fromCbor(std::string(100000, '\x81') + '\x01');
+    } catch (const std::logic_error &) { thrown = true; }
+    EQUAL(true, thrown);
+    EQUAL(Json(1), fromCbor(std::string(1000000, '\xc1') + '\x01'));
+    Json nested = fromMsgpack(std::string(kMaxBinaryDepth, '\x91') + '\x01');
+    EQUAL(true, nested.isArray());
+
+    // doubles beyond the float range are written as doubles
+    Json large = p.parse("[1e39, -1e300, 3.5]");
+    EQUAL(large, fromMsgpack(toMsgpack(large)));
+    EQUAL(large, fromCbor(toCbor(large)));
+}
+
+void test_snapshot() {
+    Parser p;
+    Json doc = p.parse(
+        "{\"name\" : \"svc\", \"port\" : 8080, \"ratio\" : 0.25, "
+        "\"tags\" : [\"a\", \"b\", null, false], \"nested\" : {\"k\" : -7}}");
+    Snapshot snap(writeSnapshot(doc));
+    SnapshotView root = snap.root();
+    EQUAL(true, root.isObject());
+    EQUAL(5, root.size());
+    EQUAL(8080, root["port"].valueInt());
+    EQUAL(0.25, root["ratio"].valueDouble());
+    EQUAL(std::string_view("svc"), root["name"].valueString());
+    EQUAL(std::string_view("b"), root["tags"][1].valueString());
+    EQUAL(true, root["tags"][2].isNull());
+    EQUAL(-7, root["nested"]["k"].valueInt());
+    EQUAL(false, root.find("missing").has_value());
+    EQUAL(doc, root.toJson());
+
+    std::string path = "snapshot_test.bin";
+    writeSnapshot(doc, path);
+    Snapshot mapped = Snapshot::open(path);
+    EQUAL(doc, mapped.root().toJson());
+    std::remove(path.c_str());
+
+    std::string corrupt = writeSnapshot(doc);
+    corrupt[20] = 0x7f;
+    bool thrown = false;
+    try {
+        Snapshot(std::move(corrupt)).root().toJson();
+    } catch (const std::logic_error &) { thrown = true; }
+    EQUAL(true, thrown);
+}
+
+struct BindInner {
+    double w = 0;
+    std::vector<int> ids;
+};
+EJSON_BIND(BindInner, w, ids)
+
+struct BindOuter {
+    std::string name;
+    int count = 0;
+    bool on = false;
+    std::optional<std::string> label;
+    std::vector<BindInner> items;
+    std::map<std::string, int> extra;
+};
+EJSON_BIND(BindOuter, name, count, on, label, items, extra)
+
+struct BindUnsigned {
+    std::uint64_t id = 0;
+    std::uint8_t small = 0;
+    std::int8_t tiny = 0;
+};
+EJSON_BIND(BindUnsigned, id, small, tiny)
+
+void test_bind() {
+    std::string text =
+        "{\"count\" : 3, \"unknown\" : {\"x\" : [1, \"]\"]}, "
+        "\"name\" : \"a\\\"b\\u00e9\", \"on\" : true, \"label\" : null, "
+        "\"items\" : [{\"w\" : 1.5, \"ids\" : [1, 2]}, {\"ids\" : []}], "
+        "\"extra\" : {\"k\" : -1}}";
+    BindOuter v = parseAs<BindOuter>(text);
+    EQUAL(3, v.count);
+    EQUAL(std::string("a\"b\xc3\xa9"), v.name);
+    EQUAL(true, v.on);
+    EQUAL(false, v.label.has_value());
+    EQUAL(2, v.items.size());
+    EQUAL(1.5, v.items[0].w);
+    EQUAL(2, v.items[0].ids[1]);
+    EQUAL(true, v.items[1].ids.empty());
+    EQUAL(-1, v.extra["k"]);
+
+    v.label = "l";
+    std::string out = stringify(v);
+    EQUAL(
+        std::string(
+            "{\"name\":\"a\\\"b\xc3\xa9\",\"count\":3,\"on\":true,"
+            "\"label\":\"l\",\"items\":[{\"w\":1.5,\"ids\":[1,2]},"
+            "{\"w\":0,\"ids\":[]}],\"extra\":{\"k\":-1}}"),
+        out);
+    BindOuter back = parseAs<BindOuter>(out);
+    EQUAL(std::string("l"), back.label.value_or(""));
+
+    constexpr auto table = bind_detail::Binder<BindOuter>::table;
+    static_assert(table.find("items") == 4);
+    static_assert(table.find("nope") == bind_detail::npos);
+
+    bool thrown = false;
+    try {
+        parseAs<BindOuter>("{\"count\" : 1.5}");
+    } catch (const std::logic_error &) { thrown = true; }
+    EQUAL(true, thrown);
+
+    BindUnsigned u = parseAs<BindUnsigned>(
+        "{\"id\" : 9007199254740993, \"small\" : 255, \"tiny\" : -128}");
+    EQUAL(9007199254740993u, u.id);
+    EQUAL(255, u.small);
+    EQUAL(-128, u.tiny);
+    const char *outOfRange[] = {
+        "{\"id\" : -1}", "{\"small\" : 256}", "{\"small\" : -1}",
+        "{\"tiny\" : 128}", "{\"tiny\" : -129}"};
+    for (const char *text : outOfRange) {
+        thrown = false;
+        try {
+            parseAs<BindUnsigned>(text);
+        } catch (const std::logic_error &) { thrown = true; }
+        EQUAL(true, thrown);
+    }
+}
+
+void test_cache() {
+    Parser p;
+    Json doc = p.parse(
+        "{\"a\" : {\"x\" : [1, 2, 3], \"y\" : null}, \"b\" : [true, {\"z\" : 1}]}");
+    Json plain = doc;
+    doc.enableCache();
+    EQUAL(plain.stringify(), doc.stringify());
+    EQUAL(plain.stringify(), doc.stringify());
+
+    doc["a"]["x"][1] = 20;
+    plain["a"]["x"][1] = 20;
+    EQUAL(plain.stringify(), doc.stringify());
+    doc["b"].push_back(Json{5});
+    plain["b"].push_back(Json{5});
+    EQUAL(plain.stringify(), doc.stringify());
+    doc["a"].erase("y");
+    plain["a"].erase("y");
+    doc.insert(std::pair<const char *, Json>("c", Json{1.5}));
+    plain.insert(std::pair<const char *, Json>("c", Json{1.5}));
+    EQUAL(plain.stringify(), doc.stringify());
+    doc["b"][1] = std::move(doc["a"]);
+    plain["b"][1] = std::move(plain["a"]);
+    EQUAL(plain.stringify(), doc.stringify());
+    EQUAL(plain.fmtStringify(), doc.fmtStringify());
+    doc.disableCache();
+    EQUAL(plain.stringify(), doc.stringify());
+
+    // Mutations through references kept from before reach every ancestor.
+    Json deep = p.parse("{\"s\" : {\"port\" : 80, \"tags\" : [\"a\"]}}");
+    deep.enableCache();
+    Json &server = deep["s"];
+    Json &port = server["port"];
+    Json &tags = server["tags"];
+    Json copy = deep;
+    EQUAL(deep.hash(), copy.hash());
+    EQUAL(deep.stringify(), copy.stringify());
+    port = 8080;
+    EQUAL(std::string("{\"s\":{\"port\":8080,\"tags\":[\"a\"]}}"),
+          deep.stringify());
+    EQUAL(false, (deep == copy));
+    copy["s"]["port"] = 8080;
+    EQUAL(true, (deep == copy));
+    tags.push_back(Json{"b"});
+    EQUAL(false, (deep == copy));
+    EQUAL(std::string("{\"s\":{\"port\":8080,\"tags\":[\"a\",\"b\"]}}"),
+          deep.stringify());
+    Json moved = std::move(tags);
+    EQUAL(std::string("{\"s\":{\"port\":8080,\"tags\":null}}"),
+          deep.stringify());
+    tags = std::move(moved);
+    Json other{2};
+    port.swap(other);
+    EQUAL(std::string("{\"s\":{\"port\":2,\"tags\":[\"a\",\"b\"]}}"),
+          deep.stringify());
+    // Values added after enableCache() are linked at the next stringify().
+    server["new"] = 1;
+    deep.stringify();
+    server["new"] = 2;
+    EQUAL(std::string("{\"s\":{\"new\":2,\"port\":2,"
+                      "\"tags\":[\"a\",\"b\"]}}"),
+          deep.stringify());
+    server.disableCache();
+    server["port"] = 3;
+    EQUAL(std::string("{\"s\":{\"new\":2,\"port\":3,"
+                      "\"tags\":[\"a\",\"b\"]}}"),
+          deep.stringify());
+    deep.stringify();
+    port = 4;
+    EQUAL(true, (deep.stringify().find("\"port\":4") != std::string::npos));
+}
+
+void test_hash() {
+    Parser p;
+    Json a = p.parse("{\"x\" : [1, 2.5, \"s\"], \"y\" : {\"z\" : null}}");
+    Json b = p.parse("{\"y\" : {\"z\" : null}, \"x\" : [1, 2.5, \"s\"]}");
+    Json c = p.parse("{\"x\" : [1, 2.5, \"t\"], \"y\" : {\"z\" : null}}");
+    EQUAL(a.hash(), b.hash());
+    EQUAL(false, (a.hash() == c.hash()));
+    EQUAL(false, (Json(1).hash() == Json(1.0).hash()));
+    EQUAL(Json(0.0).hash(), Json(-0.0).hash());
+
+    std::unordered_map<Json, int> seen;
+    seen[a] = 1;
+    seen[c] = 2;
+    EQUAL(1, seen[b]);
+    EQUAL(2, seen.size());
+
+    a.enableCache();
+    c.enableCache();
+    EQUAL(b.hash(), a.hash());
+    EQUAL(false, (a == c));
+    a["x"][2] = "t";
+    EQUAL(c.hash(), a.hash());
+    EQUAL(true, (a == c));
+}
+
+void test_unicode() {
+    Parser p;
+    EQUAL(Json("a\"b\\c/\n"), p.parse("\"a\\\"b\\\\c\\/\\n\""));
+    EQUAL(Json("\xc3\xa9\xe2\x82\xac"), p.parse("\"\\u00e9\\u20AC\""));
+    EQUAL(Json("\xf0\x9f\x98\x80"), p.parse("\"\\ud83d\\ude00\""));
+    EQUAL(
+        Json("x\xf0\x9f\x98\x80y"),
+        p.parse("{\"k\\u0021\" : \"x\\ud83d\\ude00y\"}")["k!"]);
+    std::string bad[] = {
+        "\"\\ud83d\"", "\"\\ude00\"", "\"\\u12g4\"", "\"\\q\"", "\"abc"};
+    for (const auto &s : bad) {
+        bool thrown = false;
+        try {
+            p.parse(s);
+        } catch (const std::logic_error &) { thrown = true; }
+        EQUAL(true, thrown);
+    }
+
+    // Long enough to go through the vectorized scan, with multi-byte text
+    // and an escape past the first block.
+    std::string body = std::string(40, 'a') + "\xc3\xa9\xe4\xb8\xad"
+                       + std::string(20, 'b') + "\xf0\x9f\x98\x80";
+    p.setStrictUtf8(true);
+    EQUAL(Json(body + "\n"), p.parse("\"" + body + "\\n\""));
+    std::string invalid[] = {
+        std::string(33, 'a') + "\xc3", std::string(20, 'a') + "\xc0\xaf",
+        "\xed\xa0\x80", "\xf4\x90\x80\x80", std::string(17, 'a') + "\xff"};
+    for (const auto &s : invalid) {
+        bool thrown = false;
+        try {
+            p.parse("[\"" + s + "\"]");
+        } catch (const std::logic_error &) { thrown = true; }
+        EQUAL(true, thrown);
+        EQUAL(false, validUtf8(s));
+    }
+    p.setStrictUtf8(false);
+    EQUAL(Json(invalid[4]), p.parse("\"" + invalid[4] + "\""));
+    EQUAL(true, validUtf8(body));
+
+    Tokenizer strict("\"ok\\u00e9\" \"\xc3\"", true);
+    EQUAL(std::string_view("ok\xc3\xa9"), strict.readString());
+    bool thrown = false;
+    try {
+        strict.readString();
+    } catch (const std::logic_error &) { thrown = true; }
+    EQUAL(true, thrown);
+}
+
+void test_escape() {
+    Parser p;
+    Json doc = p.parse(
+        "{\"k\\\"ey\" : [\"plain\", \"q\\\"b\\\\s\\n\\u0001\", "
+        "\"\\u00e9\\ud83d\\ude00\"]}");
+    EQUAL(
+        std::string(
+            "{\"k\\\"ey\":[\"plain\",\"q\\\"b\\\\s\\n\\u0001\","
+            "\"\xc3\xa9\xf0\x9f\x98\x80\"]}"),
+        doc.stringify());
+    EQUAL(
+        std::string(
+            "{\"k\\\"ey\":[\"plain\",\"q\\\"b\\\\s\\n\\u0001\","
+            "\"\\u00e9\\ud83d\\ude00\"]}"),
+        doc.stringify(true));
+    EQUAL(doc, p.parse(doc.stringify()));
+    EQUAL(doc, p.parse(doc.stringify(true)));
+    EQUAL(doc, p.parse(doc.fmtStringify()));
+
+    std::string long_text = std::string(50, 'x') + "\"" + std::string(30, 'y')
+                            + "\t\xe2\x82\xac" + std::string(20, 'z');
+    std::string out;
+    appendQuoted(out, long_text);
+    EQUAL(Json(long_text), p.parse(out));
+    out.clear();
+    appendQuoted(out, long_text, true);
+    EQUAL(std::string::npos, out.find('\xe2'));
+    EQUAL(Json(long_text), p.parse(out));
+    out.clear();
+    appendQuoted(out, "a\xff" "b", true);
+    EQUAL(std::string("\"a\\ufffdb\""), out);
+
+    // Non-ASCII and specials spread over several 16-byte blocks.
+    std::string mixed, expected = "\"";
+    for (int i = 0; i < 40; i++) {
+        mixed += "abcdefg\xc3\xa9" + std::string(i % 3 == 0 ? "\"" : "h");
+        expected += "abcdefg\\u00e9" + std::string(i % 3 == 0 ? "\\\"" : "h");
+    }
+    expected += "\"";
+    out.clear();
+    appendQuoted(out, mixed, true);
+    EQUAL(expected, out);
+}
+
+void test_parser_pool() {
+    // One parser reused: results stay correct, scratch is kept.
+    Parser p;
+    std::string doc = "{\"a\" : [[1, 2], [3, [4, \"x\\ny\"]]], \"b\" : []}";
+    Json first = p.parse(doc);
+    EQUAL(true, (first == p.parse(doc)));
+    EQUAL(true, (first["a"][1][1][1] == Json("x\ny")));
+    EQUAL(true, (p.scratchCapacity() >= doc.size()));
+    EQUAL(true, (p.getValue() == first));
+
+    // A failed parse does not leak elements into the next result.
+    try {
+        p.parse("[1, [2, 3");
+    } catch (std::logic_error &e) {}
+    EQUAL(std::string("[1,2]"), p.parse("[1, 2]").stringify());
+
+    // Without keepValue the result is handed over.
+    p.setKeepValue(false);
+    EQUAL(std::string("[true]"), p.parse("[true]").stringify());
+    EQUAL(true, p.getValue().isNull());
+
+    // Scratch beyond the limit is released.
+    std::string big = "[";
+    for (int i = 0; i < 2000; i++) { big += "\"some text\","; }
+    big += "0]";
+    p.setMemoryLimit(1024);
+    EQUAL((std::size_t)2001, p.parse(big).size().value());
+    p.parse("[1]");
+    EQUAL(true, (p.scratchCapacity() <= 1024));
+    p.trim();
+    EQUAL(true, (p.scratchCapacity() < 100));
+
+    ParserPool pool(1);
+    {
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        EQUAL(std::string("{\"k\":1}"), a->parse("{\"k\" : 1}").stringify());
+        EQUAL(std::string("2"), (*b).parse("2").stringify());
+        EQUAL((std::size_t)0, pool.idle());
+    }
+    EQUAL((std::size_t)1, pool.idle());
+
+    Parser &local = ParserPool::local();
+    EQUAL(&local, &ParserPool::local());
+    EQUAL(std::string("[null]"), local.parse("[null]").stringify());
+
+    // Options a borrower changes do not reach the next one.
+    const std::string badUtf8 = "[\"\xff\"]";
+    ParserPool options(1, 4096);
+    auto check = [&](Parser &parser, std::size_t limit) {
+        EQUAL(true, (parser.parse("[1, 2]").getIntArray() == nullptr));
+        EQUAL(true, parser.getValue().isNull());
+        EQUAL((std::size_t)1, parser.parse(badUtf8).size().value());
+        parser.parse(big);
+        parser.parse("[1]");
+        EQUAL(true, (parser.scratchCapacity() <= limit));
+    };
+    auto change = [&](Parser &parser) {
+        parser.setNumericArrays(true);
+        parser.setKeepValue(true);
+        parser.setStrictUtf8(true);
+        parser.setMemoryLimit(0);
+    };
+    {
+        auto lease = options.acquire();
+        change(*lease);
+    }
+    check(*options.acquire(), 4096);
+    change(ParserPool::local());
+    check(ParserPool::local(), ParserPool::kDefaultMemoryLimit);
+}
+
+void test_shared_document() {
+    const Json config = Parser().parse("{\"a\" : [1, 2], \"b\" : \"x\"}");
+    EQUAL(true, (config["a"][1] == Json(2)));
+    EQUAL(true, (config.find("c") == config.getObject()->end()));
+    bool thrown = false;
+    try {
+        config["c"];
+    } catch (std::out_of_range &e) { thrown = true; }
+    EQUAL(true, thrown);
+
+    SharedDocument doc(config);
+    EQUAL((std::uint64_t)0, doc.version());
+    {
+        auto old = doc.read();
+        doc.reload("{\"a\" : [3, 4]}");
+        // The reader keeps the document it started with.
+        EQUAL(true, (old->stringify() == config.stringify()));
+        EQUAL(true, ((*doc.read())["a"][1] == Json(4)));
+        EQUAL((std::size_t)1, doc.retired());
+    }
+    EQUAL((std::size_t)0, doc.retired());
+
+    // A failed reload keeps the current document.
+    std::promise<std::exception_ptr> failed;
+    doc.reloadAsync("{\"a\" : ", [&failed](std::exception_ptr error) {
+        failed.set_value(error);
+    });
+    thrown = false;
+    try {
+        std::rethrow_exception(failed.get_future().get());
+    } catch (std::logic_error &e) { thrown = true; }
+    EQUAL(true, thrown);
+    EQUAL((std::uint64_t)1, doc.version());
+
+    // A reload whose result is dropped still runs off the calling thread,
+    // and the destructor waits for it.
+    {
+        SharedDocument dropped;
+        std::promise<std::thread::id> ran;
+        std::string text = "[1, 2, 3]";
+        dropped.reloadAsync(text, [&ran](std::exception_ptr) {
+            ran.set_value(std::this_thread::get_id());
+        });
+        EQUAL(true, (ran.get_future().get() != std::this_thread::get_id()));
+        dropped.reloadAsync(text);
+    }
+
+    // Readers always see both members from the same document.
+    std::atomic<bool> consistent{true};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&doc, &consistent]() {
+            for (int i = 0; i < 2000; i++) {
+                auto r = doc.read();
+                if (r->isObject() && r->size() == 2
+                    && (*r)["x"] != (*r)["y"]) {
+                    consistent = false;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 200; i++) {
+        std::string n = std::to_string(i);
+        doc.reload("{\"x\" : " + n + ", \"y\" : " + n + "}");
+    }
+    for (auto &t : readers) { t.join(); }
+    EQUAL(true, consistent);
+    EQUAL((std::uint64_t)201, doc.version());
+    EQUAL((std::size_t)0, doc.retired());
+
+    // Published documents drop their caches, so concurrent const calls that
+    // would fill them only read.
+    Json cached = Parser().parse("{\"k\" : [1, {\"v\" : \"x\"}]}");
+    for (int i = 0; i < 20; i++) { cached[std::to_string(i)] = i; }
+    const std::string text = cached.stringify();
+    const std::size_t hash = cached.hash();
+    cached.enableCache();
+    doc.publish(std::move(cached));
+    std::atomic<bool> same{true};
+    readers.clear();
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&doc, &same, &text, hash]() {
+            const JsonKey key("k");
+            for (int i = 0; i < 500; i++) {
+                auto r = doc.read();
+                if (r->stringify() != text || r->hash() != hash
+                    || r->find(key) == nullptr) {
+                    same = false;
+                }
+            }
+        });
+    }
+    for (auto &t : readers) { t.join(); }
+    EQUAL(true, same);
+}
+
+void test_push_parser() {
+    const std::string text =
+        "{\"a\" : [1, -2.5e1, true, null, \"q\\\"\\u00e9\"], \"b\" : {}, "
+        "\"c\" : []}";
+    const Json expected = Parser().parse(text);
+    // Every split point, including inside strings, escapes and numbers.
+    bool same = true;
+    for (std::size_t cut = 0; cut <= text.size(); cut++) {
+        PushParser p;
+        p.feed(std::string_view(text).substr(0, cut));
+        p.feed(std::string_view(text).substr(cut));
+        same = same && p.done() && p.finish() == expected;
+    }
+    EQUAL(true, same);
+
+    // One byte at a time, and a number only completes at the end.
+    PushParser p;
+    for (char c : std::string("[12, \"x\"]")) { p.feed(std::string(1, c)); }
+    EQUAL(std::string("[12,\"x\"]"), p.finish().stringify());
+    p.feed("4");
+    p.feed("2");
+    EQUAL(false, p.done());
+    EQUAL(true, (p.finish() == Json(42)));
+
+    for (const char *bad : {"[1 2]", "{\"a\" 1}", "[1}", "tru", "[\"x", "1 2"}) {
+        bool thrown = false;
+        try {
+            PushParser q;
+            q.feed(bad);
+            q.finish();
+        } catch (std::logic_error &e) { thrown = true; }
+        EQUAL(true, thrown);
+    }
+}
+
+void test_jsonpath() {
+    const std::string text =
+        "{\"store\" : {\"book\" : ["
+        "{\"title\" : \"A\", \"price\" : 8.95, \"isbn\" : \"1\"}, "
+        "{\"title\" : \"B\", \"price\" : 12}, "
+        "{\"title\" : \"C\", \"price\" : 8, \"isbn\" : \"2\"}, "
+        "{\"title\" : \"D\", \"price\" : 22.99}], "
+        "\"bicycle\" : {\"color\" : \"red\", \"price\" : 19.95}}}";
+    const Json doc = Parser().parse(text);
+
+    // Both engines must agree; results are joined for comparison.
+    auto run = [&](const char *expression) {
+        JsonPath path(expression);
+        std::string tree, raw;
+        for (const Json *match : path.select(doc)) {
+            tree += match->stringify() + " ";
+        }
+        for (const Json &match : path.selectText(text)) {
+            raw += match.stringify() + " ";
+        }
+        return tree == raw ? tree : tree + "| " + raw;
+    };
+    EQUAL(std::string("\"A\" \"C\" "),
+          run("$.store.book[?(@.price < 10)].title"));
+    EQUAL(std::string("\"A\" \"B\" \"C\" \"D\" "), run("$.store.book[*].title"));
+    EQUAL(std::string("\"D\" "), run("$['store'][\"book\"][-1].title"));
+    EQUAL(std::string("\"A\" \"C\" "), run("$.store.book[0:4:2].title"));
+    EQUAL(std::string("\"D\" \"C\" "), run("$.store.book[:1:-1].title"));
+    EQUAL(std::string("\"1\" \"2\" "), run("$..isbn"));
+    EQUAL(std::string("\"1\" \"2\" "), run("$..book[?@.isbn].isbn"));
+    EQUAL(std::string("\"B\" \"D\" "),
+          run("$..book[?(!@.isbn && @.price >= 12)].title"));
+    EQUAL(std::string("\"C\" "),
+          run("$.store.book[?(@.title == 'C' || @.price == 1)].title"));
+    EQUAL(std::string("\"red\" "), run("$..[?(@.price > 19 && @.color)].color"));
+    EQUAL(std::string(""), run("$.store.book[9].title"));
+    EQUAL(std::string("19.950000 "), run("$.store.bicycle.price"));
+    EQUAL(std::string("12 "),
+          run("$.store.book[?(@.price > 10 && @.title != 'D')].price"));
+    EQUAL(std::string("{\"isbn\":\"2\",\"price\":8,\"title\":\"C\"} "),
+          run("$..book[?(@.price == 8)]"));
+    EQUAL(std::string("{\"color\":\"red\",\"price\":19.950000} "),
+          run("$.store[?(@.color)]"));
+    EQUAL(std::string("\"A\" \"C\" "),
+          run("$.store[?(@[?(@.isbn == '1' || @.isbn == '2')])]"
+              "[?(@.isbn)].title"));
+
+    // Filters over text test scalars and paths without decoding candidates.
+    const std::string numbers = "{\"n\" : [1, 5, {\"v\" : 7}, 3, [9]]}";
+    EQUAL(std::string("[5,3]"),
+          Json(JsonPath("$.n[?(@ > 2)]").selectText(numbers)).stringify());
+    EQUAL(std::string("[7]"),
+          Json(JsonPath("$.n[?(@.v)].v").selectText(numbers)).stringify());
+
+    // Recursive wildcard visits every value below the root: store, book,
+    // 4 books with 10 members, bicycle with 2.
+    EQUAL((std::size_t)19, JsonPath("$..*").select(doc).size());
+    EQUAL((std::size_t)19, JsonPath("$..*").selectText(text).size());
+    EQUAL(true, (JsonPath("$").select(doc).front() == &doc));
+
+    for (const char *bad : {"store", "$.", "$[1", "$[?(@.a <)]", "$.a b"}) {
+        bool thrown = false;
+        try {
+            JsonPath path(bad);
+        } catch (std::logic_error &e) { thrown = true; }
+        EQUAL(true, thrown);
+    }
+}
+
+void test_numeric_arrays() {
+    const std::string text =
+        "{\"ints\" : [1, -2, 3], \"doubles\" : [0.5, 1e3], "
+        "\"mixed\" : [1, 2.5], \"nested\" : [[1, 2], [3]]}";
+    Parser p;
+    p.setNumericArrays(true);
+    Json doc = p.parse(text);
+    const Json plain = Parser().parse(text);
+
+    const Json &ints = doc.getObject()->at("ints");
+    EQUAL(true, ints.isArray());
+    EQUAL(true, (ints.getArray() == nullptr));
+    EQUAL(true, (*ints.getIntArray() == std::vector<int>{1, -2, 3}));
+    EQUAL(1000.0, doc.getObject()->at("doubles").getDoubleArray()->at(1));
+    EQUAL(true, (doc.getObject()->at("mixed").getArray() != nullptr));
+    EQUAL(true, (doc.getObject()->at("nested").getArray() != nullptr));
+
+    // Storage does not show in comparisons, hashes or output.
+    EQUAL(true, (doc == plain));
+    EQUAL(true, (plain == doc));
+    EQUAL(doc.hash(), plain.hash());
+    EQUAL(plain.stringify(), doc.stringify());
+    EQUAL(plain.fmtStringify(), doc.fmtStringify());
+    EQUAL(toMsgpack(plain), toMsgpack(doc));
+    EQUAL(toCbor(plain), toCbor(doc));
+    EQUAL(writeSnapshot(plain), writeSnapshot(doc));
+    EQUAL(true, (Json(doc) == plain));
+    EQUAL((std::size_t)3, ints.size().value());
+    EQUAL(true, (ints.valueArray().value() == plain["ints"].valueArray().value()));
+
+    // Const element access works on numeric storage too.
+    EQUAL(-2, ints[1].valueInt().value());
+    EQUAL(1000.0, std::as_const(doc)["doubles"][1].valueDouble().value());
+    bool thrown = false;
+    try {
+        ints[3];
+    } catch (std::out_of_range &e) { thrown = true; }
+    EQUAL(true, thrown);
+
+    // So does JSONPath.
+    auto selected = JsonPath("$.ints[1]").select(doc);
+    EQUAL((std::size_t)1, selected.size());
+    EQUAL(-2, selected[0]->valueInt().value());
+    EQUAL((std::size_t)3, JsonPath("$.ints[*]").select(doc).size());
+    EQUAL((std::size_t)2, JsonPath("$.ints[-2:]").select(doc).size());
+    EQUAL((std::size_t)2, JsonPath("$.ints[?(@ > 0)]").select(doc).size());
+    selected = JsonPath("$.doubles[?(@ > 0.75)]").select(doc);
+    EQUAL((std::size_t)1, selected.size());
+    EQUAL(1000.0, selected[0]->valueDouble().value());
+    EQUAL(
+        JsonPath("$..[?(@ > 0.75)]").select(plain).size(),
+        JsonPath("$..[?(@ > 0.75)]").select(doc).size());
+
+    // Same-typed insertion keeps numeric storage, anything else falls back.
+    Json &series = doc["ints"];
+    series.push_back(Json(4));
+    series.erase(1);
+    EQUAL(true, (*series.getIntArray() == std::vector<int>{1, 3, 4}));
+    EQUAL(4, std::as_const(series)[2].valueInt().value());
+    series.push_back(Json(0.5));
+    EQUAL(true, (series.getIntArray() == nullptr));
+    EQUAL(std::string("[1,3,4,0.500000]"), series.stringify());
+    Json &reals = doc["doubles"];
+    reals[1] = Json("x");
+    EQUAL(std::string("[0.500000,\"x\"]"), reals.stringify());
+
+    // Integers beyond int are doubles rather than converted out of range.
+    EQUAL(3e9, Parser().parse("3000000000").valueDouble().value());
+    EQUAL(-2147483647 - 1, Parser().parse("-2147483648").valueInt().value());
+    EQUAL(true, (p.parse("[1, 3000000000]").getIntArray() == nullptr));
+}
+
+void test_array_reader() {
+    // Elements are parsed in place through Parser::parseView().
+    const std::string framed = "xx[1, {\"a\" : \"b\"}] yy";
+    Parser viewer;
+    EQUAL(
+        Parser().parse("[1, {\"a\" : \"b\"}]"),
+        viewer.parseView(std::string_view(framed).substr(2, 17)));
+    EQUAL(std::string("[2]"), viewer.parse("[2]").stringify());
+
+    const std::string text =
+        " [ {\"id\" : 1, \"tags\" : [\"a,]\", \"b\"]}, \"x\\\"]\", 2.5 ,"
+        "[], {\"id\" : 4} ] ";
+    const Json whole = Parser().parse(text);
+
+    // Small chunks make elements straddle reads.
+    std::istringstream in(text);
+    ArrayReader reader(in, 3);
+    std::vector<Json> items;
+    std::vector<std::uint64_t> checkpoints;
+    Json item;
+    while (reader.next(item)) {
+        items.push_back(item);
+        checkpoints.push_back(reader.checkpoint());
+    }
+    EQUAL(false, reader.next(item));
+    EQUAL(true, (Json(std::vector<Json>(items)) == whole));
+    EQUAL(',', text[checkpoints[0]]);
+
+    // Resume after the second element, as after a crash.
+    std::istringstream again(text);
+    ArrayReader resumed = ArrayReader::resume(again, checkpoints[1]);
+    std::size_t index = 2;
+    for (const Json &rest : resumed) {
+        EQUAL(true, (rest == items[index]));
+        index++;
+    }
+    EQUAL(items.size(), index);
+
+    std::istringstream empty("[ ]");
+    EQUAL(true, (ArrayReader(empty).begin() == ArrayReader::Iterator()));
+
+    // Many elements over small chunks: offsets stay right as the buffer is
+    // compacted, and trailing white space is fine.
+    std::string many = "[";
+    for (int i = 0; i < 200; i++) {
+        many += (i ? ", " : "") + std::to_string(i * 37);
+    }
+    many += "]\n ";
+    std::istringstream longer(many);
+    ArrayReader chunked(longer, 7);
+    int count = 0;
+    bool aligned = true;
+    while (chunked.next(item)) {
+        const char after = many[chunked.checkpoint()];
+        aligned = aligned && item.valueInt() == count * 37
+                  && (after == ',' || after == ']');
+        count++;
+    }
+    EQUAL(200, count);
+    EQUAL(true, aligned);
+
+    for (const char *bad :
+         {"{}", "[1, 2", "[1 2]", "[1,]", "[1] x", "[] ]", "[1],[2]"}) {
+        std::istringstream input(bad);
+        ArrayReader r(input);
+        bool thrown = false;
+        try {
+            while (r.next(item)) {}
+        } catch (std::logic_error &e) { thrown = true; }
+        EQUAL(true, thrown);
+    }
+}
+
+void test_validate() {
+    const std::string text = " {\n  \"a\" : [1, -2.5e3, true, null],\n"
+                             "  \"b \\\"c\\u00e9\" : {\"d\" : [ ]} ,\n"
+                             "  \"e\" : \"x y\"\n}\n";
+    EQUAL(true, (bool)validate(text));
+    std::string out = "<";
+    EQUAL(true, (bool)minify(text, out));
+    EQUAL(
+        std::string("<{\"a\":[1,-2.5e3,true,null],\"b \\\"c\\u00e9\":"
+                    "{\"d\":[]},\"e\":\"x y\"}"),
+        out);
+    EQUAL(true, (Parser().parse(out.substr(1)) == Parser().parse(text)));
+
+    // Offsets point at the offending byte.
+    struct Case {
+        const char *text;
+        std::size_t offset;
+    };
+    for (Case c : {Case{"", 0}, Case{"[1,]", 3}, Case{"{\"a\" 1}", 5},
+                   Case{"[1 2]", 3}, Case{"{\"a\":01}", 6},
+                   Case{"\"\\x\"", 1}, Case{"[\"\x01\"]", 2},
+                   Case{"[tru]", 1}, Case{"{} x", 3}, Case{"[[]", 3},
+                   Case{"\"\\ud800\"", 1}}) {
+        Validation v = validate(c.text);
+        EQUAL(false, (bool)v);
+        EQUAL(c.offset, v.offset);
+        std::string kept = "kept";
+        EQUAL(false, (bool)minify(c.text, kept));
+        EQUAL(std::string("kept"), kept);
+    }
+    EQUAL(false, (bool)validate("\"\xff\"", true));
+    EQUAL(true, (bool)validate("\"\xff\""));
+
+    std::string deep(kMaxValidateDepth, '[');
+    deep += std::string(kMaxValidateDepth, ']');
+    EQUAL(true, (bool)validate(deep));
+    EQUAL(false, (bool)validate("[" + deep + "]"));
+}
+
+void test_patch() {
+    Parser p;
+    const Json from = p.parse(
+        "{\"a\" : {\"x\" : 1, \"y\" : [1, 2, 3, 4]}, \"b/c\" : \"s\", "
+        "\"d\" : [{\"k\" : 1}, {\"k\" : 2}], \"e\" : true}");
+    const Json to = p.parse(
+        "{\"a\" : {\"x\" : 2, \"y\" : [1, 9, 3, 4, 5]}, \"d\" : "
+        "[{\"k\" : 2}], \"e\" : true, \"f\" : null}");
+    const Json ops = diff(from, to);
+    EQUAL(
+        std::string("[{\"op\":\"replace\",\"path\":\"/a/x\",\"value\":2},"
+                    "{\"op\":\"replace\",\"path\":\"/a/y/1\",\"value\":9},"
+                    "{\"op\":\"add\",\"path\":\"/a/y/4\",\"value\":5},"
+                    "{\"op\":\"remove\",\"path\":\"/b~1c\"},"
+                    "{\"op\":\"remove\",\"path\":\"/d/0\"},"
+                    "{\"op\":\"add\",\"path\":\"/f\",\"value\":null}]"),
+        ops.stringify());
+    Json doc = from;
+    applyPatch(doc, ops);
+    EQUAL(true, (doc == to));
+    EQUAL((std::size_t)0, diff(to, doc).size().value());
+
+    // Numeric storage diffs like generic storage.
+    p.setNumericArrays(true);
+    Json series = p.parse("[1, 2, 3]");
+    const Json longer = p.parse("[1, 2, 3, 4]");
+    applyPatch(series, diff(series, longer));
+    EQUAL(true, (series == longer));
+    EQUAL(true, (series.getIntArray() != nullptr));
+    p.setNumericArrays(false);
+    EQUAL(
+        (std::size_t)0,
+        diff(p.parse("{\"a\" : [[1, 2], [0.5]]}"),
+             Parser().parse("{\"a\" : [[1, 2], [0.5]]}"))
+            .size()
+            .value());
+
+    // A change deep down is found below many unchanged siblings.
+    std::string deep, changed;
+    for (int i = 0; i < 100; i++) {
+        deep += "{\"same\" : [1, {\"x\" : \"y\"}], \"next\" : ";
+    }
+    changed = deep + "2" + std::string(100, '}');
+    deep += "1" + std::string(100, '}');
+    const Json deepOps = diff(p.parse(deep), p.parse(changed));
+    EQUAL((std::size_t)1, deepOps.size().value());
+    std::string deepPath;
+    for (int i = 0; i < 100; i++) { deepPath += "/next"; }
+    EQUAL(Json(deepPath), deepOps[(std::size_t)0]["path"]);
+
+    // move relinks the subtree instead of copying it.
+    Json tree = p.parse("{\"a\" : {\"s\" : \"text\"}, \"b\" : [0]}");
+    const std::string *text = tree["a"]["s"].getString();
+    applyPatch(
+        tree,
+        p.parse("[{\"op\" : \"move\", \"from\" : \"/a/s\", "
+                "\"path\" : \"/b/-\"}, {\"op\" : \"copy\", \"from\" : "
+                "\"/b/0\", \"path\" : \"/c\"}, {\"op\" : \"test\", "
+                "\"path\" : \"/b/1\", \"value\" : \"text\"}]"));
+    EQUAL(true, (tree["b"][1].getString() == text));
+    EQUAL(std::string("{\"a\":{},\"b\":[0,\"text\"],\"c\":0}"),
+          tree.stringify());
+
+    for (const char *bad :
+         {"[{\"op\" : \"remove\", \"path\" : \"/x\"}]",
+          "[{\"op\" : \"add\", \"path\" : \"/b/3\", \"value\" : 1}]",
+          "[{\"op\" : \"test\", \"path\" : \"/c\", \"value\" : 1}]",
+          "[{\"op\" : \"move\", \"from\" : \"/b\", \"path\" : "
+          "\"/b/0\"}]",
+          "[{\"op\" : \"jump\", \"path\" : \"\"}]",
+          "[{\"op\" : \"replace\", \"path\" : \"/b/01\", \"value\" : "
+          "1}]"}) {
+        bool thrown = false;
+        try {
+            applyPatch(tree, p.parse(bad));
+        } catch (std::logic_error &e) { thrown = true; }
+        EQUAL(true, thrown);
+    }
+
+    // The example of RFC 7386.
+    Json target = p.parse(
+        "{\"title\" : \"Goodbye!\", \"author\" : {\"givenName\" : "
+        "\"John\", \"familyName\" : \"Doe\"}, \"tags\" : [\"example\", "
+        "\"sample\"], \"content\" : \"This will be unchanged\"}");
+    applyMergePatch(
+        target,
+        p.parse("{\"title\" : \"Hello!\", \"phoneNumber\" : "
+                "\"+01-555-1234\", \"author\" : {\"familyName\" : null}, "
+                "\"tags\" : [\"example\"]}"));
+    EQUAL(
+        std::string("{\"author\":{\"givenName\":\"John\"},\"content\":"
+                    "\"This will be unchanged\",\"phoneNumber\":"
+                    "\"+01-555-1234\",\"tags\":[\"example\"],\"title\":"
+                    "\"Hello!\"}"),
+        target.stringify());
+}
+
+void test_columns() {
+    ColumnBuilder builder;
+    builder.appendArray(
+        "[{\"id\" : 1, \"name\" : \"a\", \"score\" : 1, \"ok\" : true},"
+        " {\"id\" : 2, \"name\" : \"b\", \"score\" : 2.5, \"tag\" : [1]},"
+        " {\"name\" : \"a\", \"id\" : 3, \"score\" : null}]");
+    builder.appendLines(
+        "{\"id\" : 4, \"name\" : \"c\\n\", \"ok\" : 1}\n\n"
+        "{\"id\" : 5000000000, \"tag\" : \"x\"}\n");
+    Json record = Parser().parse(
+        "{\"id\" : 6, \"name\" : \"b\", \"score\" : 0.125}");
+    builder.append(record);
+    EQUAL((std::size_t)6, builder.rows());
+    const Table table = builder.finish();
+    EQUAL((std::size_t)0, builder.rows());
+    EQUAL((std::size_t)6, table.rows);
+    EQUAL((std::size_t)5, table.columns.size());
+    EQUAL(std::string("ok"), table.columns[3].name);
+
+    const Column &id = *table.column("id");
+    EQUAL(true, (id.kind == Column::Kind::INT));
+    EQUAL(true, (id.ints == std::vector<std::int64_t>{1, 2, 3, 4, 5000000000, 6}));
+
+    // Strings are stored once per distinct value.
+    const Column &name = *table.column("name");
+    EQUAL(true, (name.kind == Column::Kind::STRING));
+    EQUAL(true, (name.codes == std::vector<std::uint32_t>{0, 1, 0, 2, 0, 1}));
+    EQUAL(std::string("abc\n"), name.chars);
+    EQUAL(true, name.isNull(4));
+    EQUAL(std::string("c\n"), std::string(name.string(3)));
+    EQUAL(std::string("b"), std::string(name.string(5)));
+
+    // Entries stay valid as later fields add columns.
+    ColumnBuilder growing;
+    const std::string label = "a label longer than any small string";
+    std::string lines = "{\"s\" : \"" + label + "\"}\n";
+    for (int i = 0; i < 64; i++) {
+        lines += "{\"s\" : \"" + label + "\", \"c" + std::to_string(i)
+                 + "\" : \"v\"}\n";
+    }
+    growing.appendLines(lines);
+    const Table grown = growing.finish();
+    EQUAL((std::size_t)65, grown.columns.size());
+    EQUAL(label, grown.columns[0].chars);
+    EQUAL(
+        true,
+        (grown.columns[0].codes == std::vector<std::uint32_t>(65, 0)));
+
+    // Integers widen to doubles, missing fields and nulls are null.
+    const Column &score = *table.column("score");
+    EQUAL(true, (score.kind == Column::Kind::DOUBLE));
+    EQUAL(0.125, score.doubles[5]);
+    EQUAL(1.0, score.doubles[0]);
+    EQUAL(true, score.isNull(2));
+    EQUAL(true, score.isNull(3));
+    EQUAL(false, score.isNull(1));
+    EQUAL((std::size_t)6, score.doubles.size());
+
+    // Mixed kinds fall back to Json.
+    const Column &ok = *table.column("ok");
+    EQUAL(true, (ok.kind == Column::Kind::JSON));
+    EQUAL(true, (ok.value(0) == Json(true)));
+    EQUAL(true, (ok.value(3) == Json(1)));
+    EQUAL(true, ok.isNull(1));
+    const Column &tag = *table.column("tag");
+    EQUAL(true, (tag.kind == Column::Kind::JSON));
+    EQUAL(std::string("[1]"), tag.value(1).stringify());
+    EQUAL(std::string("\"x\""), tag.value(4).stringify());
+    EQUAL(true, (table.column("missing") == nullptr));
+
+    ColumnBuilder plain(false);
+    plain.appendLines("{\"s\" : \"xy\"}\n{}\n{\"s\" : \"z\"}");
+    const Table strings = plain.finish();
+    const Column &s = strings.columns[0];
+    EQUAL(true, s.codes.empty());
+    EQUAL(true, (s.offsets == std::vector<std::size_t>{0, 2, 2, 3}));
+    EQUAL(std::string("z"), std::string(s.string(2)));
+
+    bool thrown = false;
+    try {
+        ColumnBuilder().appendLines("{\"a\" : 1, \"a\" : 2}");
+    } catch (std::logic_error &e) { thrown = true; }
+    EQUAL(true, thrown);
+}
+
+constexpr auto kLiteral = EJSON_LITERAL(R"({
+    "port" : 8080, "name" : "srv\u00e9\n", "ratio" : 0.25,
+    "big" : 3000000000, "tags" : ["a", true, null, -1.5e2, {}],
+    "nested" : {"z" : 1, "a" : [[]]}, "pi" : 3.14159265358979
+})");
+static_assert(kLiteral.root()["port"].valueInt() == 8080);
+static_assert(kLiteral.root()["tags"][3].valueDouble() == -150.0);
+static_assert(!kLiteral.root().find("missing").has_value());
+
+void test_literal() {
+    const LiteralValue root = kLiteral.root();
+    EQUAL((std::size_t)7, root.size().value());
+    EQUAL(
+        std::string("srv\u00e9\n"), std::string(*root["name"].valueString()));
+    EQUAL(0.25, root["ratio"].valueDouble().value());
+    EQUAL(3e9, root["big"].valueDouble().value());
+    EQUAL(3.14159265358979, root["pi"].valueDouble().value());
+    EQUAL(true, root["tags"][1].valueBool().value());
+    EQUAL(true, root["tags"][2].isNull());
+    EQUAL((std::size_t)0, root["tags"][4].size().value());
+    // Members are in key order.
+    EQUAL(std::string("a"), std::string(root["nested"][0].key()));
+    EQUAL(std::string("big"), std::string(root[0].key()));
+
+    const std::string text =
+        R"({"a" : [1, 2.5, "x", {"b" : null}], "c" : false})";
+    constexpr auto doc = EJSON_LITERAL(
+        R"({"a" : [1, 2.5, "x", {"b" : null}], "c" : false})");
+    EQUAL(true, (doc.root().toJson() == Parser().parse(text)));
+    // 3000000000 does not fit an int and is a double everywhere.
+    const std::string literal = R"({
+        "port" : 8080, "name" : "srv\u00e9\n", "ratio" : 0.25,
+        "big" : 3000000000, "tags" : ["a", true, null, -1.5e2, {}],
+        "nested" : {"z" : 1, "a" : [[]]}, "pi" : 3.14159265358979
+    })";
+    EQUAL(true, (root.toJson() == Tokenizer(literal).readValue()));
+    EQUAL(true, (root.toJson() == Parser().parse(literal)));
+
+    bool thrown = false;
+    try {
+        root["nope"];
+    } catch (std::out_of_range &e) { thrown = true; }
+    EQUAL(true, thrown);
+    // Outside constant evaluation errors throw like the Parser.
+    thrown = false;
+    try {
+        literalNodes("{\"a\" : }");
+    } catch (std::logic_error &e) { thrown = true; }
+    EQUAL(true, thrown);
+}
+
+void test_incremental() {
+    IncrementalDocument doc(
+        "{\"servers\" : [{\"host\" : \"a\", \"port\" : 80}, "
+        "{\"host\" : \"b\", \"port\" : 81}], \"debug\" : false}");
+    auto check = [&]() {
+        return doc.value() == Tokenizer(doc.text()).readValue();
+    };
+    EQUAL(true, doc.valid());
+    auto port = doc.span("/servers/1/port").value();
+    EQUAL(std::string("81"), doc.text().substr(port.first, 2));
+
+    // Typing in a number re-parses only that number.
+    EQUAL(true, doc.edit(port.first + 1, 1, "080"));
+    EQUAL((std::size_t)4, doc.lastReparsed());
+    EQUAL(8080, doc.value()["servers"][1]["port"].valueInt().value());
+    EQUAL(true, check());
+
+    // Later spans moved with the edit.
+    auto debug = doc.span("/debug").value();
+    EQUAL(std::string("false"), doc.text().substr(debug.first, 5));
+    EQUAL(true, doc.edit(debug.first, 5, "true"));
+    EQUAL((std::size_t)4, doc.lastReparsed());
+    EQUAL(true, check());
+
+    // An edit that is not a value on its own widens to the enclosing one.
+    auto host = doc.span("/servers/0/host").value();
+    EQUAL(true, doc.edit(host.second, 0, ", \"tls\" : true"));
+    const Json &server = doc.value()["servers"].getArray()->front();
+    EQUAL(true, server["tls"].valueBool().value());
+    EQUAL(true, check());
+    auto first = doc.span("/servers/0").value();
+    EQUAL(first.second - first.first, doc.lastReparsed());
+    EQUAL(false, doc.span("/servers/2").has_value());
+
+    // Invalid intermediate text keeps the last tree until it is fixed.
+    const Json before = doc.value();
+    EQUAL(false, doc.edit(host.first, 1, ""));
+    EQUAL(false, doc.valid());
+    EQUAL(false, doc.error().empty());
+    EQUAL(true, (doc.value() == before));
+    EQUAL(true, doc.edit(host.first, 0, "\""));
+    EQUAL(true, doc.valid());
+    EQUAL(true, check());
+
+    // Duplicate keys: the shadowed member is not patched in.
+    IncrementalDocument dup("{\"a\" : 1, \"a\" : 2}");
+    EQUAL(true, dup.edit(7, 1, "5"));
+    EQUAL(2, dup.value()["a"].valueInt().value());
+    EQUAL(true, dup.edit(16, 1, "7"));
+    EQUAL(7, dup.value()["a"].valueInt().value());
+    EQUAL((std::size_t)1, dup.lastReparsed());
+
+    bool thrown = false;
+    try {
+        dup.edit(100, 0, "x");
+    } catch (std::out_of_range &e) { thrown = true; }
+    EQUAL(true, thrown);
+}
+
+void test_lookup() {
+    std::map<std::string, Json> members;
+    for (int i = 0; i < 40; i++) {
+        members.emplace("key" + std::to_string(i), Json(i));
+    }
+    Json doc(std::move(members));
+    const Json &object = doc;
+
+    std::string_view name = "key7-and-more";
+    EQUAL(7, object.get(name.substr(0, 4))->valueInt().value());
+    EQUAL(true, (object.get("nope") == nullptr));
+    EQUAL(true, (Json(1).get("key7") == nullptr));
+    EQUAL(true, (object.find(name.substr(0, 5)) == object.getObject()->end()));
+    EQUAL(std::string("key12"), doc.find(std::string_view("key12"))->first);
+    EQUAL(3, object["key3"].valueInt().value());
+
+    // Batch lookup, both as one walk and key by key.
+    const std::string_view keys[] = {"key9", "zzz", "key0", "key39", "key1"};
+    const Json *found[5];
+    object.findAll(keys, 5, found);
+    EQUAL(9, found[0]->valueInt().value());
+    EQUAL(true, (found[1] == nullptr));
+    EQUAL(0, found[2]->valueInt().value());
+    EQUAL(39, found[3]->valueInt().value());
+    EQUAL(1, found[4]->valueInt().value());
+    object.findAll(keys, 1, found);
+    EQUAL(9, found[0]->valueInt().value());
+
+    // Key handles, through the map and through the cached hash index.
+    const JsonKey key("key21"), missing("key40");
+    EQUAL(21, object.find(key)->valueInt().value());
+    doc.enableCache();
+    EQUAL(21, object.find(key)->valueInt().value());
+    EQUAL(true, (object.find(missing) == nullptr));
+    doc.insert(std::make_pair("key40", Json(40)));
+    doc.erase("key21");
+    EQUAL(40, object.find(missing)->valueInt().value());
+    EQUAL(true, (object.find(key) == nullptr));
+    Json copy = doc;
+    EQUAL(40, copy.find(missing)->valueInt().value());
+}
+
 void test() {
     test_c();
     test_type();
     test_parser();
+    test_parallel();
+    test_binary();
+    test_snapshot();
+    test_bind();
+    test_cache();
+    test_hash();
+    test_unicode();
+    test_escape();
+    test_parser_pool();
+    test_shared_document();
+    test_push_parser();
+    test_jsonpath();
+    test_numeric_arrays();
+    test_array_reader();
+    test_validate();
+    test_patch();
+    test_columns();
+    test_literal();
+    test_incremental();
+    test_lookup();
 }
 int main() {
     test();